@@ -0,0 +1,128 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "AsGraph.h"
+
+using std::cout, std::endl, std::cerr, std::string, std::vector;
+
+/*
+How evenly the ranks are split over the pool, RankSplit::UNIFORM (8 ASes
+per chunk) against RankSplit::COST (chunks of equal estimated cost), with
+both engines on one pool of the given size.
+
+Chunks are timed with each thread's CPU clock, so the numbers hold when the
+pool has more threads than the machine has cores. Summed over every
+parallel step of a propagation:
+
+- work: CPU time of all chunks
+- critical: the busiest thread of each step, what the step took
+- bound: max(biggest chunk, work / threads) per step, the best any
+  schedule of those chunks could do. On an oversubscribed machine the OS
+  decides who runs, so critical says little and bound is the number to
+  compare.
+
+The per-thread busy and idle times are from the last repetition.
+
+usage: bench_balance <as-rel2 file> <anns.csv> [rov_asns.csv] [threads] [repetitions]
+ */
+
+struct Totals
+{
+    double wallMs = 0;
+    double workMs = 0;
+    double criticalMs = 0;
+    double boundMs = 0;
+    double worstStepMs = 0; // the step whose bound is furthest above work / threads
+};
+
+static Totals summarize(const AsGraph &graph, unsigned threads)
+{
+    Totals totals;
+    for (const RankStats &step : graph.getRankStats())
+    {
+        double even = step.timing.workMs / threads;
+        double bound = std::max(step.timing.maxChunkMs, even);
+        totals.workMs += step.timing.workMs;
+        totals.criticalMs += step.timing.criticalMs;
+        totals.boundMs += bound;
+        totals.worstStepMs = std::max(totals.worstStepMs, bound - even);
+    }
+    return totals;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "usage: " << argv[0] << " <as-rel2 file> <anns.csv> [rov_asns.csv] [threads] [repetitions]" << endl;
+        return 1;
+    }
+    unsigned threads = argc > 4 ? std::stoul(argv[4]) : std::max(2u, std::thread::hardware_concurrency());
+    int reps = argc > 5 ? std::stoi(argv[5]) : 3;
+
+    ThreadPool pool(threads);
+    pool.useCpuClock(true);
+    AsGraph graph(nullptr, &pool);
+    if (argc > 3 && graph.loadROVDeployment(argv[3]) != 0)
+    {
+        return 1;
+    }
+    if (graph.buildGraph(argv[1]) != 0)
+    {
+        return 1;
+    }
+    if (!graph.flattenGraph())
+    {
+        cerr << "graph has a provider-customer cycle" << endl;
+        return 1;
+    }
+
+    cout << "ASes: " << graph.getAsMap().size() << ", threads: " << threads
+         << ", hardware threads: " << std::thread::hardware_concurrency() << endl;
+    for (PropagationEngine engine : {PropagationEngine::PUSH, PropagationEngine::PULL})
+    {
+        graph.setPropagationEngine(engine);
+        for (RankSplit split : {RankSplit::UNIFORM, RankSplit::COST})
+        {
+            graph.setRankSplit(split);
+            Totals best;
+            best.boundMs = 1e18;
+            for (int rep = 0; rep < reps; ++rep)
+            {
+                graph.clearRoutes();
+                graph.processInitialAnnouncements(argv[2]);
+                pool.resetStats();
+
+                auto start = std::chrono::steady_clock::now();
+                graph.propagateUp();
+                graph.propagateAcross();
+                graph.propagateDown();
+                auto end = std::chrono::steady_clock::now();
+
+                Totals totals = summarize(graph, threads);
+                totals.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+                if (totals.boundMs < best.boundMs)
+                {
+                    best = totals;
+                }
+            }
+
+            cout << (engine == PropagationEngine::PUSH ? "push" : "pull") << " "
+                 << (split == RankSplit::COST ? "cost   " : "uniform") << ": steps " << graph.getRankStats().size()
+                 << ", wall " << best.wallMs << " ms, work " << best.workMs << " ms, critical " << best.criticalMs
+                 << " ms, bound " << best.boundMs << " ms (even split " << best.workMs / threads
+                 << " ms), worst step +" << best.worstStepMs << " ms" << endl;
+            cout << "  busy/idle ms per thread:";
+            for (const ThreadStats &t : graph.getThreadStats())
+            {
+                cout << " " << t.busyMs << "/" << t.idleMs;
+            }
+            cout << endl;
+        }
+    }
+    return 0;
+}
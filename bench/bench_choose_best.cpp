@@ -0,0 +1,221 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#include "Route.h"
+#include "PathPool.h"
+#include "Relationships.h"
+
+using std::cout, std::endl, std::string, std::vector;
+
+/*
+chooseBest throughput on the packed Route against the layout Announcement
+had before it (prefix string, path vector, next hop, relationship, flag):
+
+    legacy  - the old chooseBest over that layout, path length is vector::size
+    branchy - the same compare chain over Route fields
+    key     - Route::chooseBest, one compare of rankKey()
+    batch   - Route::selectBest over each prefix's candidates stored together
+
+The first three fold `candidates` random routes into a per-prefix best in
+arrival order, the way BGP::enqueueRoute does. batch sees the same
+candidates grouped by prefix (in arrival order within a prefix). All of them
+must pick the same winners. Few prefixes means many candidates per prefix,
+the popular-prefix case.
+
+usage: bench_choose_best [prefixes] [candidates] [repetitions]
+ */
+
+struct LegacyAnnouncement
+{
+    string prefix;
+    vector<int> asPath;
+    int nextHopAsn;
+    Relationship relationship;
+    bool rovInvalid;
+};
+
+static const LegacyAnnouncement *legacyChooseBest(const LegacyAnnouncement *curr, const LegacyAnnouncement *cand)
+{
+    if (curr == nullptr)
+        return cand;
+
+    if (cand->relationship > curr->relationship)
+        return cand;
+
+    if (cand->relationship < curr->relationship)
+        return curr;
+
+    if (cand->asPath.size() < curr->asPath.size())
+        return cand;
+
+    if (cand->asPath.size() > curr->asPath.size())
+        return curr;
+
+    if (cand->nextHopAsn < curr->nextHopAsn)
+        return cand;
+
+    return curr;
+}
+
+// the field by field chooseBest Route had before rankKey
+static const Route *branchyChooseBest(const Route *curr, const Route *cand)
+{
+    if (curr == nullptr)
+        return cand;
+
+    if (cand->getRelationship() > curr->getRelationship())
+        return cand;
+
+    if (cand->getRelationship() < curr->getRelationship())
+        return curr;
+
+    if (cand->getPathLength() < curr->getPathLength())
+        return cand;
+
+    if (cand->getPathLength() > curr->getPathLength())
+        return curr;
+
+    if (cand->getNextHopAsn() < curr->getNextHopAsn())
+        return cand;
+
+    return curr;
+}
+
+template <typename Fn>
+static double timeMs(int reps, Fn &&fn)
+{
+    double best = 1e18;
+    for (int i = 0; i < reps; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t prefixes = argc > 1 ? std::stoul(argv[1]) : 4096;
+    size_t candidates = argc > 2 ? std::stoul(argv[2]) : 4000000;
+    int reps = argc > 3 ? std::stoi(argv[3]) : 5;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> prefixDist(0, prefixes - 1);
+    std::uniform_int_distribution<int> relDist(1, 4);
+    std::uniform_int_distribution<int> lenDist(1, 8);
+    std::uniform_int_distribution<int> asnDist(1, 60000);
+
+    PathPool pool;
+    vector<LegacyAnnouncement> legacy;
+    vector<Route> packed;
+    vector<uint32_t> prefixOf;
+    legacy.reserve(candidates);
+    packed.reserve(candidates);
+    prefixOf.reserve(candidates);
+    for (size_t i = 0; i < candidates; ++i)
+    {
+        uint32_t prefixId = prefixDist(rng);
+        vector<int> path(lenDist(rng));
+        for (int &asn : path)
+        {
+            asn = asnDist(rng);
+        }
+        Relationship rel = static_cast<Relationship>(relDist(rng));
+        int nextHop = path.front();
+
+        packed.emplace_back(prefixId, pool.intern(path), nextHop, rel, false, pool);
+        legacy.push_back({std::to_string(prefixId), std::move(path), nextHop, rel, false});
+        prefixOf.push_back(prefixId);
+    }
+
+    // the same candidates grouped by prefix, arrival order kept inside a group
+    vector<size_t> groupStart(prefixes + 1, 0);
+    for (uint32_t p : prefixOf)
+    {
+        ++groupStart[p + 1];
+    }
+    for (uint32_t p = 0; p < prefixes; ++p)
+    {
+        groupStart[p + 1] += groupStart[p];
+    }
+    vector<Route> grouped(candidates);
+    vector<size_t> groupedFrom(candidates);
+    {
+        vector<size_t> next(groupStart.begin(), groupStart.end() - 1);
+        for (size_t i = 0; i < candidates; ++i)
+        {
+            size_t pos = next[prefixOf[i]]++;
+            grouped[pos] = packed[i];
+            groupedFrom[pos] = i;
+        }
+    }
+
+    vector<const LegacyAnnouncement *> legacyBest(prefixes);
+    vector<const Route *> branchyBest(prefixes);
+    vector<const Route *> keyBest(prefixes);
+    vector<size_t> batchBest(prefixes);
+
+    double legacyMs = timeMs(reps, [&]
+                             {
+        std::fill(legacyBest.begin(), legacyBest.end(), nullptr);
+        for (size_t i = 0; i < candidates; ++i)
+        {
+            const LegacyAnnouncement *&best = legacyBest[prefixOf[i]];
+            best = legacyChooseBest(best, &legacy[i]);
+        } });
+    double branchyMs = timeMs(reps, [&]
+                              {
+        std::fill(branchyBest.begin(), branchyBest.end(), nullptr);
+        for (size_t i = 0; i < candidates; ++i)
+        {
+            const Route *&best = branchyBest[packed[i].getPrefixId()];
+            best = branchyChooseBest(best, &packed[i]);
+        } });
+    double keyMs = timeMs(reps, [&]
+                          {
+        std::fill(keyBest.begin(), keyBest.end(), nullptr);
+        for (size_t i = 0; i < candidates; ++i)
+        {
+            const Route *&best = keyBest[packed[i].getPrefixId()];
+            best = Route::chooseBest(best, &packed[i]);
+        } });
+    double batchMs = timeMs(reps, [&]
+                            {
+        for (uint32_t p = 0; p < prefixes; ++p)
+        {
+            size_t first = groupStart[p];
+            batchBest[p] = first + Route::selectBest(grouped.data() + first, groupStart[p + 1] - first);
+        } });
+
+    for (uint32_t p = 0; p < prefixes; ++p)
+    {
+        if (legacyBest[p] == nullptr)
+        {
+            continue;
+        }
+        size_t winner = legacyBest[p] - legacy.data();
+        if (static_cast<size_t>(branchyBest[p] - packed.data()) != winner ||
+            static_cast<size_t>(keyBest[p] - packed.data()) != winner || groupedFrom[batchBest[p]] != winner)
+        {
+            std::cerr << "winner mismatch for prefix " << p << endl;
+            return 1;
+        }
+    }
+
+    auto report = [candidates](const char *name, double ms)
+    {
+        cout << name << ms << " ms, " << candidates / ms / 1000.0 << " M/s" << endl;
+    };
+    cout << "candidates: " << candidates << ", prefixes: " << prefixes << ", legacy record "
+         << sizeof(LegacyAnnouncement) << " bytes + path, Route " << sizeof(Route) << " bytes" << endl;
+    report("legacy:  ", legacyMs);
+    report("branchy: ", branchyMs);
+    report("key:     ", keyMs);
+    report("batch:   ", batchMs);
+    return 0;
+}
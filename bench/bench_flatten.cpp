@@ -0,0 +1,146 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <random>
+#include <filesystem>
+#include <unordered_map>
+
+#include "AsGraph.h"
+
+using std::cout, std::endl, std::cerr, std::string, std::vector, std::unordered_map;
+
+/*
+Rank computation on a synthetic deep hierarchy:
+
+    worklist - the old flattenGraph, which re-pushes a provider every time
+               one of its customers raises its rank (unordered_map ranks)
+    kahn     - AsGraph::flattenGraph, customer-count countdown over the CSR
+               topology, every AS ranked once
+
+The generated graph has `depth` layers of `width` ASes. Every AS below the
+top layer buys transit from `providers` random ASes in higher layers, so
+providers are reached through many customer paths of different lengths.
+
+usage: bench_flatten [depth] [width] [providers] [repetitions]
+ */
+
+template <typename Fn>
+static double timeMs(int reps, Fn &&fn)
+{
+    double best = 1e18;
+    for (int i = 0; i < reps; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+static void writeHierarchy(const string &fileName, int depth, int width, int providers)
+{
+    std::mt19937 rng(42);
+    std::ofstream out(fileName);
+    for (int layer = 1; layer < depth; ++layer)
+    {
+        for (int i = 0; i < width; ++i)
+        {
+            int asn = layer * width + i + 1;
+            // mostly the layer right above, sometimes far up the hierarchy
+            std::uniform_int_distribution<int> upper(std::max(0, layer - 8), layer - 1);
+            std::uniform_int_distribution<int> column(0, width - 1);
+            for (int p = 0; p < providers; ++p)
+            {
+                int providerLayer = p == 0 ? layer - 1 : upper(rng);
+                out << providerLayer * width + column(rng) + 1 << "|" << asn << "|-1|bgp\n";
+            }
+        }
+    }
+}
+
+// the pre-countdown flattenGraph, returns the number of worklist pushes
+static size_t worklistRanks(const AsGraph &graph, unordered_map<int, int> &rankMap)
+{
+    const auto &asMap = graph.getAsMap();
+    rankMap.clear();
+    vector<int> ranks;
+    for (const auto &pair : asMap)
+    {
+        if (pair.second->getCustomers().empty())
+        {
+            rankMap[pair.first] = 0;
+            ranks.push_back(pair.first);
+        }
+        else
+        {
+            rankMap[pair.first] = -1;
+        }
+    }
+
+    for (size_t i = 0; i < ranks.size(); ++i)
+    {
+        int asn = ranks[i];
+        int newRank = rankMap[asn] + 1;
+        for (int pAsn : asMap.at(asn)->getProviders())
+        {
+            if (newRank > rankMap[pAsn])
+            {
+                rankMap[pAsn] = newRank;
+                ranks.push_back(pAsn);
+            }
+        }
+    }
+    return ranks.size();
+}
+
+int main(int argc, char **argv)
+{
+    int depth = argc > 1 ? std::stoi(argv[1]) : 64;
+    int width = argc > 2 ? std::stoi(argv[2]) : 2000;
+    int providers = argc > 3 ? std::stoi(argv[3]) : 3;
+    int reps = argc > 4 ? std::stoi(argv[4]) : 5;
+
+    string fileName = (std::filesystem::temp_directory_path() / "bench_flatten_graph.txt").string();
+    writeHierarchy(fileName, depth, width, providers);
+
+    AsGraph graph;
+    int status = graph.buildGraph(fileName);
+    std::filesystem::remove(fileName);
+    if (status != 0)
+    {
+        return 1;
+    }
+
+    unordered_map<int, int> rankMap;
+    size_t pushes = 0;
+    double worklistMs = timeMs(reps, [&]
+                               { pushes = worklistRanks(graph, rankMap); });
+    bool acyclic = true;
+    double kahnMs = timeMs(reps, [&]
+                           { acyclic = graph.flattenGraph(); });
+
+    if (!acyclic)
+    {
+        cerr << "generated graph has a cycle" << endl;
+        return 1;
+    }
+    const auto &flattened = graph.getFlattenedGraph();
+    for (size_t r = 0; r < flattened.size(); ++r)
+    {
+        for (int asn : flattened[r])
+        {
+            if (rankMap.at(asn) != static_cast<int>(r))
+            {
+                cerr << "rank mismatch for AS " << asn << endl;
+                return 1;
+            }
+        }
+    }
+
+    cout << "ASes: " << graph.getAsMap().size() << ", ranks: " << flattened.size() << endl;
+    cout << "worklist: " << worklistMs << " ms, " << pushes << " pushes" << endl;
+    cout << "kahn:     " << kahnMs << " ms, " << graph.getAsMap().size() << " pushes" << endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "AsGraph.h"
+#include "CaidaParser.h"
+#include "Utils.h"
+
+using std::cout, std::endl, std::cerr, std::string, std::vector, std::ifstream;
+
+/*
+Compares CAIDA ingest paths on one as-rel2 file:
+
+    legacy  - getline + Utils::split + stoi (what buildGraph used to do)
+    mmap    - MappedFile + CaidaParser (what buildGraph does now)
+    chunks  - CaidaParser::parseChunks on N threads (tokenizing only)
+    build   - the full AsGraph::buildGraph, parsing plus graph insertion,
+              serial and with N ingest threads
+
+usage: bench_ingest <as-rel2 file> [repetitions] [threads]
+ */
+
+static long legacyParse(const string &fileName)
+{
+    ifstream input(fileName);
+    string line;
+    long checksum = 0;
+    while (getline(input, line))
+    {
+        if (line.find("#") != string::npos || line.empty())
+        {
+            continue;
+        }
+        vector<string> tokens = Utils::split(line, '|');
+        checksum += stoi(tokens[0]) + stoi(tokens[1]) + stoi(tokens[2]);
+    }
+    return checksum;
+}
+
+static long mappedParse(const string &fileName)
+{
+    long checksum = 0;
+    CaidaParser::parseFile(fileName, [&checksum](int src, int dst, RelationshipType rel)
+                           { checksum += src + dst + static_cast<int>(rel); });
+    return checksum;
+}
+
+template <typename Fn>
+static double timeMs(int reps, Fn &&fn)
+{
+    double best = 1e18;
+    for (int i = 0; i < reps; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cerr << "usage: " << argv[0] << " <as-rel2 file> [repetitions] [threads]" << endl;
+        return 1;
+    }
+    string fileName = argv[1];
+    int reps = argc > 2 ? std::stoi(argv[2]) : 5;
+    unsigned threads = argc > 3 ? std::stoul(argv[3]) : std::thread::hardware_concurrency();
+
+    long legacySum = 0, mappedSum = 0;
+    double legacyMs = timeMs(reps, [&]
+                             { legacySum = legacyParse(fileName); });
+    double mappedMs = timeMs(reps, [&]
+                             { mappedSum = mappedParse(fileName); });
+    double chunksMs = timeMs(reps, [&]
+                             {
+        MappedFile file;
+        file.open(fileName);
+        CaidaParser::parseChunks(file.begin(), file.end(), threads); });
+    double buildMs = timeMs(reps, [&]
+                            { AsGraph graph; graph.buildGraph(fileName); });
+    double parallelBuildMs = timeMs(reps, [&]
+                                    { AsGraph graph; graph.buildGraph(fileName, threads); });
+
+    if (legacySum != mappedSum)
+    {
+        cerr << "checksum mismatch: " << legacySum << " vs " << mappedSum << endl;
+        return 1;
+    }
+
+    cout << "legacy getline/split/stoi: " << legacyMs << " ms" << endl;
+    cout << "mmap + from_chars:         " << mappedMs << " ms" << endl;
+    cout << "parseChunks (" << threads << " threads):  " << chunksMs << " ms" << endl;
+    cout << "buildGraph (serial):       " << buildMs << " ms" << endl;
+    cout << "buildGraph (" << threads << " threads):   " << parallelBuildMs << " ms" << endl;
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+
+#include "AsGraph.h"
+
+using std::cout, std::endl, std::cerr, std::string;
+
+/*
+End to end run of one scenario (what main does minus the output file),
+timing every phase and reporting the peak resident set size and the
+number of heap allocations made while propagating.
+
+usage: bench_propagation <as-rel2 file> <anns.csv> [rov_asns.csv]
+
+e.g. bench_propagation bench/many/CAIDAASGraphCollector_2025.10.15.txt bench/many/anns.csv bench/many/rov_asns.csv
+ */
+
+// every operator new in the process, counted to compare propagation allocations
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point &start)
+{
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - start).count();
+    start = now;
+    return ms;
+}
+
+static long peakRssKiB()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "usage: " << argv[0] << " <as-rel2 file> <anns.csv> [rov_asns.csv]" << endl;
+        return 1;
+    }
+
+    AsGraph graph;
+    auto start = std::chrono::steady_clock::now();
+    auto phase = start;
+
+    if (argc > 3 && graph.loadROVDeployment(argv[3]) != 0)
+    {
+        return 1;
+    }
+    if (graph.buildGraph(argv[1]) != 0)
+    {
+        return 1;
+    }
+    double buildMs = elapsedMs(phase);
+
+    if (!graph.flattenGraph())
+    {
+        cerr << "graph has a provider-customer cycle" << endl;
+        return 1;
+    }
+    double flattenMs = elapsedMs(phase);
+
+    graph.processInitialAnnouncements(argv[2]);
+    double seedMs = elapsedMs(phase);
+
+    size_t allocsBefore = allocations.load();
+    graph.propagateUp();
+    double upMs = elapsedMs(phase);
+    graph.propagateAcross();
+    double acrossMs = elapsedMs(phase);
+    graph.propagateDown();
+    double downMs = elapsedMs(phase);
+    size_t propagationAllocs = allocations.load() - allocsBefore;
+
+    size_t routes = 0;
+    for (const auto &pair : graph.getAsMap())
+    {
+        routes += pair.second->getPolicy().getlocalRib().size();
+    }
+    double totalMs = elapsedMs(start);
+
+    // what running another scenario on the same graph starts with
+    phase = std::chrono::steady_clock::now();
+    graph.clearRoutes();
+    double resetMs = elapsedMs(phase);
+
+    cout << "ASes: " << graph.getAsMap().size() << ", routes: " << routes << endl;
+    cout << "build " << buildMs << " ms, flatten " << flattenMs << " ms, seed " << seedMs << " ms" << endl;
+    cout << "up " << upMs << " ms, across " << acrossMs << " ms, down " << downMs << " ms" << endl;
+    cout << "propagation allocations " << propagationAllocs << ", clearRoutes " << resetMs << " ms" << endl;
+    cout << "total " << totalMs << " ms, peak RSS " << peakRssKiB() / 1024 << " MiB" << endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include "AsGraph.h"
+
+using std::cout, std::endl, std::cerr, std::string, std::vector;
+
+/*
+Propagation scaling over the thread count. The graph is built and
+flattened once, then every thread count (1, 2, 4, ... up to max, and max
+itself) seeds and propagates the same scenario on that graph, with the push
+engine, the pull engine and prefix-sharded propagation (propagateByPrefix).
+The best of the repetitions is reported with the speedup over the push
+engine on one thread.
+
+Every run must give the same RIBs, checked with a hash over each AS's
+(prefix id, path) pairs. The paths are hashed hop by hop: shards and pool
+threads intern through their own indexes, so the same path can have a
+different PathHandle in each run.
+
+usage: bench_scaling <as-rel2 file> <anns.csv> [rov_asns.csv] [max threads] [repetitions]
+
+e.g. bench_scaling bench/many/CAIDAASGraphCollector_2025.10.15.txt bench/many/anns.csv bench/many/rov_asns.csv 64
+ */
+
+static uint64_t ribHash(const AsGraph &graph)
+{
+    const PathPool &paths = graph.getPathPool();
+    uint64_t hash = 0;
+    for (const auto &[asn, as] : graph.getAsMap())
+    {
+        uint64_t asHash = static_cast<uint32_t>(asn);
+        as->getPolicy().getlocalRib().forEachRoute([&](const Route &route)
+                                                   {
+            uint64_t routeHash = route.getPrefixId();
+            paths.walk(route.getPath(), [&](int hop)
+                       { routeHash = routeHash * 1000003 ^ static_cast<uint32_t>(hop); });
+            asHash = asHash * 1000003 ^ routeHash; });
+        // order of the AS map does not matter
+        hash += asHash * 0x9e3779b97f4a7c15ULL;
+    }
+    return hash;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "usage: " << argv[0] << " <as-rel2 file> <anns.csv> [rov_asns.csv] [max threads] [repetitions]" << endl;
+        return 1;
+    }
+    unsigned maxThreads = argc > 4 ? std::stoul(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+    int reps = argc > 5 ? std::stoi(argv[5]) : 3;
+
+    AsGraph graph;
+    if (argc > 3 && graph.loadROVDeployment(argv[3]) != 0)
+    {
+        return 1;
+    }
+    if (graph.buildGraph(argv[1]) != 0)
+    {
+        return 1;
+    }
+    if (!graph.flattenGraph())
+    {
+        cerr << "graph has a provider-customer cycle" << endl;
+        return 1;
+    }
+
+    vector<unsigned> counts;
+    for (unsigned t = 1; t < maxThreads; t *= 2)
+    {
+        counts.push_back(t);
+    }
+    counts.push_back(maxThreads);
+
+    cout << "ASes: " << graph.getAsMap().size() << ", hardware threads: " << std::thread::hardware_concurrency() << endl;
+    double serialMs = 0;
+    uint64_t expected = 0;
+    for (unsigned threads : counts)
+    {
+        graph.setThreadCount(threads);
+        for (const char *mode : {"push", "pull", "sharded"})
+        {
+            graph.setPropagationEngine(string(mode) == "pull" ? PropagationEngine::PULL : PropagationEngine::PUSH);
+            double best = 1e18;
+            for (int rep = 0; rep < reps; ++rep)
+            {
+                graph.clearRoutes();
+                graph.processInitialAnnouncements(argv[2]);
+
+                auto start = std::chrono::steady_clock::now();
+                if (string(mode) == "sharded")
+                {
+                    graph.propagateByPrefix();
+                }
+                else
+                {
+                    graph.propagateUp();
+                    graph.propagateAcross();
+                    graph.propagateDown();
+                }
+                auto end = std::chrono::steady_clock::now();
+                best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+
+                uint64_t hash = ribHash(graph);
+                if (expected == 0)
+                {
+                    expected = hash;
+                }
+                else if (hash != expected)
+                {
+                    cerr << "RIBs differ with " << threads << " threads (" << mode << ")" << endl;
+                    return 1;
+                }
+            }
+            if (serialMs == 0)
+            {
+                serialMs = best;
+            }
+            cout << "threads " << threads << " " << mode << ": propagation " << best << " ms, speedup "
+                 << serialMs / best << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <filesystem>
+
+#include "AsGraph.h"
+
+using std::cout, std::endl, std::cerr, std::string;
+
+/*
+Cold start comparison: everything main does before propagation, once from
+the CAIDA text file and once from a binary snapshot of the same graph.
+
+    text     - loadROVDeployment + buildGraph + flattenGraph (which checks for cycles)
+    snapshot - loadSnapshot
+
+usage: bench_snapshot <as-rel2 file> <rov_asns.csv> [repetitions]
+ */
+
+template <typename Fn>
+static double timeMs(int reps, Fn &&fn)
+{
+    double best = 1e18;
+    for (int i = 0; i < reps; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "usage: " << argv[0] << " <as-rel2 file> <rov_asns.csv> [repetitions]" << endl;
+        return 1;
+    }
+    string graphFile = argv[1];
+    string rovFile = argv[2];
+    int reps = argc > 3 ? std::stoi(argv[3]) : 5;
+    string snapshotFile = "bench_snapshot.snap";
+
+    {
+        AsGraph graph;
+        graph.loadROVDeployment(rovFile);
+        graph.buildGraph(graphFile);
+        if (graph.saveSnapshot(snapshotFile) != 0)
+        {
+            cerr << "Failed to write snapshot" << endl;
+            return 1;
+        }
+    }
+
+    double textMs = timeMs(reps, [&]
+                           {
+        AsGraph graph;
+        graph.loadROVDeployment(rovFile);
+        graph.buildGraph(graphFile);
+        graph.flattenGraph(); });
+    double snapshotMs = timeMs(reps, [&]
+                               {
+        AsGraph graph;
+        graph.loadSnapshot(snapshotFile); });
+
+    cout << "snapshot size: " << std::filesystem::file_size(snapshotFile) << " bytes" << endl;
+    cout << "text cold start:     " << textMs << " ms" << endl;
+    cout << "snapshot cold start: " << snapshotMs << " ms" << endl;
+
+    std::filesystem::remove(snapshotFile);
+    return 0;
+}
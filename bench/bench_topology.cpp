@@ -0,0 +1,110 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "AsGraph.h"
+
+using std::cout, std::endl, std::cerr, std::string;
+
+/*
+Compares the hash-map adjacency (asMap lookups through the AS neighbor
+vectors) against the CSR Topology on one graph:
+
+    memory    - estimated bytes of the old adjacency list (getAdjacencyList)
+                + AS neighbor vectors vs CSR arrays
+    traversal - time to visit every provider, customer and peer edge once
+
+usage: bench_topology <as-rel2 file> [repetitions]
+ */
+
+template <typename Fn>
+static double timeMs(int reps, Fn &&fn)
+{
+    double best = 1e18;
+    for (int i = 0; i < reps; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+static size_t hashLayoutBytes(const AsGraph &graph)
+{
+    // libstdc++ node: next pointer + key/value (+ malloc header), plus one pointer per bucket
+    const size_t mallocOverhead = 16;
+    const auto &adjacencyList = graph.getAdjacencyList();
+    size_t bytes = adjacencyList.bucket_count() * sizeof(void *);
+    for (const auto &pair : adjacencyList)
+    {
+        bytes += sizeof(void *) + sizeof(pair) + mallocOverhead;
+        bytes += pair.second.capacity() * sizeof(pair.second[0]) + mallocOverhead;
+    }
+    for (const auto &pair : graph.getAsMap())
+    {
+        const AS *as = pair.second;
+        bytes += (as->getProviders().capacity() + as->getCustomers().capacity() + as->getPeers().capacity()) * sizeof(int);
+        bytes += 3 * mallocOverhead;
+    }
+    return bytes;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cerr << "usage: " << argv[0] << " <as-rel2 file> [repetitions]" << endl;
+        return 1;
+    }
+    int reps = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    AsGraph graph;
+    if (graph.buildGraph(argv[1]) != 0)
+    {
+        return 1;
+    }
+    const auto &asMap = graph.getAsMap();
+    const Topology &topology = graph.getTopology();
+
+    long hashSum = 0, csrSum = 0;
+    double hashMs = timeMs(reps, [&]
+                           {
+        hashSum = 0;
+        for (const auto &pair : asMap)
+        {
+            const AS *as = pair.second;
+            for (const auto *neighbors : {&as->getProviders(), &as->getCustomers(), &as->getPeers()})
+            {
+                for (int asn : *neighbors)
+                {
+                    hashSum += asMap.find(asn)->second->getAsn();
+                }
+            }
+        } });
+    double csrMs = timeMs(reps, [&]
+                          {
+        csrSum = 0;
+        for (uint32_t idx = 0; idx < topology.size(); ++idx)
+        {
+            for (NeighborRange neighbors : {topology.getProviders(idx), topology.getCustomers(idx), topology.getPeers(idx)})
+            {
+                for (uint32_t nIdx : neighbors)
+                {
+                    csrSum += topology.asnOf(nIdx);
+                }
+            }
+        } });
+
+    if (hashSum != csrSum)
+    {
+        cerr << "traversal mismatch: " << hashSum << " vs " << csrSum << endl;
+        return 1;
+    }
+
+    cout << "ASes: " << topology.size() << endl;
+    cout << "hash-map adjacency: ~" << hashLayoutBytes(graph) / 1024 << " KiB, traversal " << hashMs << " ms" << endl;
+    cout << "CSR topology:        " << topology.memoryBytes() / 1024 << " KiB, traversal " << csrMs << " ms" << endl;
+    return 0;
+}
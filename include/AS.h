@@ -2,40 +2,66 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <memory_resource>
+#include <variant>
 
 #include "Policy.h"
 #include "BGP.h"
 #include "ROV.h"
 
-using std::string, std::vector, std::unique_ptr, std::make_unique;
+using std::string, std::vector;
 
 class AS
 {
 private:
     int asn;
+    uint32_t index; // dense index assigned when the AS is first seen
+    PolicyKind policyKind;
     vector<int> providers;
     vector<int> customers;
     vector<int> peers;
-    unique_ptr<Policy> policy;
 
-public:
-    AS(int asn, bool useROV = false) : asn(asn)
+    /*
+    The routing policy lives inline, no heap object per AS. ROV is a BGP with
+    a receive filter, so getRouter() can always hand out the BGP part and the
+    propagation engine applies the filter from policyKind at compile time.
+     */
+    using PolicyVariant = std::variant<BGP, ROV>;
+    PolicyVariant policy;
+
+    static bool eraseAll(vector<int> &neighbors, int asn)
     {
-        if (useROV)
-        {
-            policy = make_unique<ROV>(asn);
-        }
-        else
-        {
-            policy = make_unique<BGP>(asn);
-        }
+        auto it = std::remove(neighbors.begin(), neighbors.end(), asn);
+        bool found = it != neighbors.end();
+        neighbors.erase(it, neighbors.end());
+        return found;
     }
 
+public:
+    // the policy keeps its routes in resource and its paths in paths (see BGP)
+    AS(int asn, bool useROV = false, uint32_t index = 0,
+       std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+       PathPool *paths = &PathPool::global())
+        : asn(asn), index(index), policyKind(useROV ? PolicyKind::ROV : PolicyKind::BGP),
+          policy(useROV ? PolicyVariant(std::in_place_type<ROV>, asn, resource, paths)
+                        : PolicyVariant(std::in_place_type<BGP>, asn, resource, paths)) {}
+
     int getAsn() const
     {
         return this->asn;
     }
 
+    uint32_t getIndex() const
+    {
+        return this->index;
+    }
+
+    PolicyKind getPolicyKind() const
+    {
+        return this->policyKind;
+    }
+
     void addProvider(int providerAsn)
     {
         this->providers.push_back(providerAsn);
@@ -51,6 +77,22 @@ public:
         this->peers.push_back(peerAsn);
     }
 
+    // removes every occurrence, returns whether the neighbor was there
+    bool removeProvider(int providerAsn)
+    {
+        return eraseAll(this->providers, providerAsn);
+    }
+
+    bool removeCustomer(int customerAsn)
+    {
+        return eraseAll(this->customers, customerAsn);
+    }
+
+    bool removePeer(int peerAsn)
+    {
+        return eraseAll(this->peers, peerAsn);
+    }
+
     const vector<int> &getProviders() const
     {
         return providers;
@@ -66,13 +108,22 @@ public:
         return peers;
     }
 
+    // the policy through its virtual interface, ROV filtering included
     Policy &getPolicy()
     {
-        return *policy;
+        return getRouter();
     }
 
     const Policy &getPolicy() const
     {
-        return *policy;
+        return std::visit([](const auto &p) -> const Policy &
+                          { return p; }, policy);
+    }
+
+    // the BGP part of the policy, for non-virtual calls that already know policyKind
+    BGP &getRouter()
+    {
+        return std::visit([](auto &p) -> BGP &
+                          { return p; }, policy);
     }
 };
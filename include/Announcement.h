@@ -5,66 +5,174 @@
 #include <memory>
 
 #include "Relationships.h"
+#include "PrefixTable.h"
+#include "PathPool.h"
+#include "Route.h"
 
-using std::string, std::vector, std::ostream;
+using std::string, std::vector, std::ostream, std::unique_ptr;
 
+/*
+Public view of a route: the packed Route plus a path vector handed out on
+demand. RIBs and pending slots store Route, Announcement is what callers
+construct and what LocalRib lookups return.
+
+The path handle belongs to pool: PathPool::global() for announcements
+built by hand, the graph's pool for one read out of a graph's RIB. A
+policy re-interns an announcement from another pool when it takes it in
+(routeIn).
+ */
 class Announcement
 {
 private:
-    string prefix;             // the IP prefix being announced
-    vector<int> asPath;        // path the announcement has taken up to the current point (pre-pendeded)
-    int nextHopAsn;            // the AS that sent this announcement to us
-    Relationship relationship; // the relationship of the AS that sent the announcement
-    bool rovInvalid;           // whether the announcement failed ROV checks
+    Route route;                            // prefix id, path handle, next hop and packed metadata
+    PathPool *pool = &PathPool::global();   // where route's path lives
+
+    /*
+    getAsPath() hands out a vector, materialized on first use. Once the
+    mutable overload is called the vector is the path (pathDetached) and the
+    handle is interned from it whenever it is asked for.
+    Propagation never touches this.
+     */
+    mutable unique_ptr<vector<int>> pathCache;
+    bool pathDetached = false;
+
 public:
     Announcement() = default;
 
+    // a stored route, whose path is a handle into pool
+    Announcement(const Route &route, PathPool &pool = PathPool::global()) : route(route), pool(&pool) {}
+
     Announcement(const string &prefix, const vector<int> &asPath, int nextHopAsn, Relationship relationship, bool rovInvalid = false)
+        : Announcement(PrefixTable::global().intern(prefix), PathPool::global().intern(asPath), nextHopAsn, relationship, rovInvalid) {}
+
+    Announcement(uint32_t prefixId, const vector<int> &asPath, int nextHopAsn, Relationship relationship, bool rovInvalid = false)
+        : Announcement(prefixId, PathPool::global().intern(asPath), nextHopAsn, relationship, rovInvalid) {}
+
+    // asPath is a handle into PathPool::global()
+    Announcement(uint32_t prefixId, PathHandle asPath, int nextHopAsn, Relationship relationship, bool rovInvalid = false)
+        : route(prefixId, asPath, nextHopAsn, relationship, rovInvalid, PathPool::global()) {}
+
+    // copies share the interned path, never the materialized vector
+    Announcement(const Announcement &other) : route(other.getRoute()), pool(other.pool) {}
+
+    Announcement &operator=(const Announcement &other)
+    {
+        if (this != &other)
+        {
+            route = other.getRoute();
+            pool = other.pool;
+            pathCache.reset();
+            pathDetached = false;
+        }
+        return *this;
+    }
+
+    Announcement(Announcement &&) = default;
+    Announcement &operator=(Announcement &&) = default;
+
+    // the packed record, with the path re-interned if it was edited through getAsPath
+    Route getRoute() const
+    {
+        if (!pathDetached)
+        {
+            return route;
+        }
+        return Route(route.getPrefixId(), pool->intern(*pathCache), route.getNextHopAsn(),
+                     route.getRelationship(), route.isRovInvalid(), *pool);
+    }
+
+    // getRoute() with the path interned into target, for a policy that keeps its paths there
+    Route routeIn(PathPool &target) const
     {
-        this->prefix = prefix;
-        this->asPath = asPath;
-        this->nextHopAsn = nextHopAsn;
-        this->relationship = relationship;
-        this->rovInvalid = rovInvalid;
+        if (&target == pool)
+        {
+            return getRoute();
+        }
+        return Route(route.getPrefixId(), target.intern(getAsPath()), route.getNextHopAsn(),
+                     route.getRelationship(), route.isRovInvalid(), target);
     }
 
+    // the pool getPathHandle() refers to
+    PathPool &getPathPool() const
+    {
+        return *pool;
+    }
+
+    // looks the prefix string up, propagation should use getPrefixId
     const string &getPrefix() const
     {
-        return prefix;
+        return PrefixTable::global().get(route.getPrefixId());
+    }
+
+    uint32_t getPrefixId() const
+    {
+        return route.getPrefixId();
     }
 
-    const Relationship &getRelationship() const
+    Relationship getRelationship() const
     {
-        return this->relationship;
+        return route.getRelationship();
     }
 
     bool isRovInvalid() const
     {
-        return this->rovInvalid;
+        return route.isRovInvalid();
+    }
+
+    PathHandle getPathHandle() const
+    {
+        return pathDetached ? pool->intern(*pathCache) : route.getPath();
+    }
+
+    // O(1), packed into the route
+    uint32_t getPathLength() const
+    {
+        return pathDetached ? static_cast<uint32_t>(pathCache->size()) : route.getPathLength();
+    }
+
+    // one new path node, the rest of the path is shared
+    void prependAsn(int asn)
+    {
+        route = getRoute();
+        route.prependAsn(asn, *pool);
+        pathCache.reset();
+        pathDetached = false;
     }
 
+    // the path as a vector, built by walking the path nodes
     const vector<int> &getAsPath() const
     {
-        return this->asPath;
+        if (!pathCache)
+        {
+            pathCache = std::make_unique<vector<int>>(pool->toVector(route.getPath()));
+        }
+        return *pathCache;
     }
 
     vector<int> &getAsPath()
     {
-        return this->asPath;
+        static_cast<const Announcement *>(this)->getAsPath();
+        pathDetached = true;
+        return *pathCache;
     }
 
-    const void setAsPath(const vector<int> &newAsPath)
+    void setAsPath(const vector<int> &newAsPath)
     {
-        this->asPath = newAsPath;
+        route = Route(route.getPrefixId(), pool->intern(newAsPath), route.getNextHopAsn(),
+                      route.getRelationship(), route.isRovInvalid(), *pool);
+        pathCache.reset();
+        pathDetached = false;
     }
 
     int getNextHopAsn() const
     {
-        return this->nextHopAsn;
+        return route.getNextHopAsn();
     }
 
     void setNextHopAsn(int newNextHopAsn)
     {
-        this->nextHopAsn = newNextHopAsn;
+        route = getRoute().forwarded(newNextHopAsn, route.getRelationship());
+        pathCache.reset();
+        pathDetached = false;
     }
 };
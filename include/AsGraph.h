@@ -7,92 +7,514 @@
 #include <vector>
 #include <string>
 #include <unordered_set>
+#include <deque>
+#include <algorithm>
+#include <thread>
 
 #include "AS.h"
+#include "Topology.h"
+#include "RankLayers.h"
+#include "LocalRib.h"
+#include "RunArena.h"
+#include "ThreadPool.h"
+#include "PrefixIndex.h"
+#include "Route.h"
 
-using std::string, std::vector, std::unordered_map, std::pair, std::unique_ptr, std::unordered_set;
+using std::string, std::vector, std::unordered_map, std::pair, std::unordered_set, std::deque;
+
+// what buildGraph keeps when two lines give the same AS pair different relationships
+enum class ConflictRule
+{
+    KEEP_FIRST, // the earliest line in the file wins
+    KEEP_LAST,  // the latest line in the file wins
+    DROP        // the pair is left without a relationship
+};
+
+// what buildGraph collapsed while reading relationship lines
+struct IngestStats
+{
+    size_t lines = 0;      // relationship lines read
+    size_t duplicates = 0; // lines repeating a relationship already read (including b|a for peers)
+    size_t conflicts = 0;  // lines disagreeing with an earlier line for the same pair
+};
+
+// how routes move between neighbors during propagation
+enum class PropagationEngine
+{
+    PUSH, // up and down: senders enqueue into their neighbors serially, then each rank is processed on the pool
+    PULL  // up and down: every receiver reads its neighbors' RIBs itself, so sending runs on the pool too
+};
+
+// how each rank is cut into chunks for the pool
+enum class RankSplit
+{
+    UNIFORM, // chunks of the same number of ASes
+    COST     // chunks of about the same estimated cost (inbox length and neighbor degree)
+};
+
+enum class PropagationPhase
+{
+    UP,
+    ACROSS,
+    DOWN
+};
+
+// one parallel step of propagation (a rank, or all ASes for across), see AsGraph::getRankStats
+struct RankStats
+{
+    PropagationPhase phase;
+    size_t rank;        // index into the flattened ranks, 0 for across
+    size_t ases;        // ASes in the step
+    uint64_t cost;      // estimated cost of the whole step, 0 with RankSplit::UNIFORM or when there was nothing to cut
+    RoundStats timing;  // critical path, total work and the biggest chunk
+};
+
+// the route one AS uses for one address, see AsGraph::lookupRoutes
+struct RouteMatch
+{
+    uint32_t prefixId = PrefixTable::NOT_FOUND; // longest prefix in the AS's RIB containing the address
+    Route route;                                // the AS's route for it, valid if found()
+
+    bool found() const
+    {
+        return prefixId != PrefixTable::NOT_FOUND;
+    }
+};
 
 class AsGraph
 {
 private:
-    unordered_map<int, unique_ptr<AS>> asMap;                              // mapping of ASN to AS node
-    unordered_map<int, vector<pair<int, RelationshipType>>> adjacencyList; // asn -> list of (neighbor_asn, relationship_type)
-    vector<vector<int>> flattenedGraph;                                    // ranks of ASNs for propagation
+    RunArena arena;                                                        // per-run route storage, declared first so it outlives asNodes
+    PathPool paths;                                                        // AS paths of every route in the graph, outlives asNodes too
+    std::pmr::memory_resource *routeResource;                              // where RIBs and pending slots allocate, &arena by default
+    ThreadPool *pool;                                                      // runs each rank's processAnnouncements, ownPool by default
+    std::unique_ptr<ThreadPool> ownPool;                                   // started on the first propagation if no pool was passed in
+    unsigned numThreads;                                                   // size of ownPool, one per hardware thread by default
+    unordered_map<int, AS *> asMap;                                        // mapping of ASN to AS node (owned by asNodes)
+    RankLayers<int> flattenedGraph;                                        // ranks of ASNs for propagation
     unordered_set<int> rovEnabledAsns;                                     // ASNs that deploy ROV
+    deque<AS> asNodes;                                                     // AS nodes in dense index order, interned at load time
+    Topology topology;                                                     // CSR adjacency over dense AS indices, what everything past ingest reads
+    vector<BGP *> routers;                                                 // dense index -> BGP part of the policy (RIB and inbox)
+    vector<PolicyKind> policyKinds;                                        // dense index -> BGP or ROV, selects the send loop
+    RankLayers<uint32_t> rankIndices;                                      // flattenedGraph as dense indices
+    vector<uint32_t> rankOf;                                               // dense index -> propagation rank
 
-    bool hasCycle_helper(int src, unordered_set<int> &visited, unordered_set<int> &safe)
-    {
-        if (safe.find(src) != safe.end())
-        {
-            return false;
-        }
-        if (visited.find(src) != visited.end())
-        {
-            return true;
-        }
-
-        visited.insert(src);
-        for (const auto &nei : adjacencyList[src])
-        {
-            int neiNode = nei.first;
-            RelationshipType neiRelationship = nei.second;
-            // we don't follow peer-to-peer edges as they are bidirectional
-            if (neiRelationship != RelationshipType::PEER_TO_PEER && hasCycle_helper(neiNode, visited, safe))
-            {
-                return true;
-            }
-        }
-        visited.erase(src);
-
-        safe.insert(src);
-        return false;
-    }
+    vector<int> cycle;                                                     // provider->customer cycle found by the last flattenGraph, if any
+
+    // relationship recorded for an AS pair during ingest
+    struct SeenEdge
+    {
+        int srcAsn;
+        RelationshipType relType;
+        bool dropped; // removed by ConflictRule::DROP, later lines are ignored
+    };
+    unordered_map<uint64_t, SeenEdge> seenEdges;                           // (min ASN, max ASN) -> relationship, only during buildGraph
+    ConflictRule conflictRule = ConflictRule::KEEP_FIRST;
+    IngestStats ingestStats;
+
+    RibLayout ribLayout = RibLayout::AUTO;                                 // requested RIB layout for the next seeding
+    RibLayout seededLayout = RibLayout::SPARSE;                            // layout the RIBs ended up with
+    vector<uint32_t> seededIds;                                            // prefix ids seeded since the last clearRoutes, sorted, no duplicates
+    DenseRibStore denseRib;                                                // rows of the dense RIBs, if they are used
+    PrefixIndex prefixIndex;                                               // longest-prefix match over the interned prefixes
+    PropagationEngine engine = PropagationEngine::PUSH;
+    RankSplit rankSplit = RankSplit::COST;
+    vector<RankStats> rankStats;                                           // every parallel step since the last propagateUp or clearRoutes
+    vector<uint64_t> costPrefix;                                           // scratch for runBalanced, prefix sums of the costs
+    vector<size_t> chunkBounds;                                            // scratch for runBalanced
+
+    /*
+    Iterative DFS over provider->customer edges starting at src, using dense
+    visit states (0 = unvisited, 1 = on the current path, 2 = finished).
+    Returns the offending cycle as dense indices (first node repeated at the
+    end), or an empty vector if no cycle is reachable from src.
+     */
+    vector<uint32_t> walkCustomers(uint32_t src, vector<uint8_t> &state,
+                                   vector<pair<uint32_t, uint32_t>> &stack);
+
+    // lays out the ranks in rankOf as flattenedGraph and rankIndices
+    void layoutRanks(uint32_t rankCount);
+
+    // returns the node for an ASN, creating it with the next dense index if it is new
+    AS *internAs(int asn);
+
+    // builds the CSR topology and the dense per-AS arrays once ingest is done
+    void buildTopology();
+
+    // fills routers and policyKinds from asNodes
+    void indexRouters();
+
+    // parses the file on numThreads threads, then merges the edges in file order
+    int buildGraphParallel(const string &fileName, unsigned numThreads);
+
+    // inserts one CAIDA edge into asMap and the AS neighbor vectors
+    void addEdge(int srcAsn, int dstAsn, RelationshipType relType);
+
+    // addEdge for a freshly parsed line: skips duplicates and resolves conflicts with conflictRule
+    void ingestEdge(int srcAsn, int dstAsn, RelationshipType relType);
+
+    // drops the ingest-only pair index and builds the topology
+    void finishIngest();
+
+    // the pool propagation runs on, starting the graph's own (numThreads) on first use
+    ThreadPool &threadPool();
+
+    /*
+    Runs work(begin, end) over [0, count) on the pool. With RankSplit::COST
+    the range is cut where the prefix sums of cost(i) cross equal shares, so
+    an expensive AS gets a chunk of its own; cheap steps run on the caller.
+    With one thread or one AS the costs are not computed at all.
+    The step's timing is appended to rankStats.
+     */
+    template <typename CostFn, typename WorkFn>
+    void runBalanced(PropagationPhase phase, size_t rank, size_t count, const CostFn &cost, const WorkFn &work);
+
+    // processAnnouncements for every AS of rankIndices[rank], split over the pool
+    void processRank(PropagationPhase phase, size_t rank);
+
+    // propagateUp and propagateDown for PropagationEngine::PULL, propagateAcross always pulls
+    void pullUp();
+    void pullDown();
+
+    // routes one prefix shard ended with, per AS in dense index order
+    struct ShardRoutes
+    {
+        vector<uint32_t> offsets; // AS index -> first route, one extra entry at the end
+        vector<Route> routes;     // global prefix ids
+    };
+
+    /*
+    Runs up, across and down on the calling thread for the prefix ids
+    seededIds[first, last), on private per-AS BGP states seeded from the
+    origins in the RIBs, and collects the resulting routes into out.
+     */
+    void propagateShard(size_t first, size_t last, ShardRoutes &out);
+
+    // attaches every RIB to a DenseRibStore row if ribLayout (or the density heuristic) asks for it
+    void chooseRibLayout(const vector<Announcement> &seeds);
+
+    // looks up the CAIDA edge srcAsn|dstAsn in srcAsn's neighbor vectors, false if there is none
+    bool findEdge(int srcAsn, int dstAsn, RelationshipType &relType) const;
+
+    // reverses addEdge for the CAIDA edge srcAsn|dstAsn|relType
+    void removeEdge(int srcAsn, int dstAsn, RelationshipType relType);
+
+    /*
+    Whether adding provider->customer would close a cycle, i.e. provider is
+    already in customer's customer cone. Only ASes ranked above the provider
+    can reach it, so everything else is pruned; when the provider already
+    outranks the customer no search is needed at all.
+    On a cycle, fills cycle with provider -> customer -> ... -> provider.
+     */
+    bool closesCycle(AS *provider, AS *customer);
+
+    /*
+    Recomputes the rank of asn and of everything above it in rankOf, after
+    asn's customer set changed. Only that provider cone can change depth,
+    and it is re-ranked with the same countdown as flattenGraph.
+     */
+    void rerankProviderCone(int asn);
 
 public:
-    AsGraph() {}
+    /*
+    RIBs and pending announcements are drawn from resource, or from the
+    graph's own RunArena (thread-local bump buffers) when it is nullptr.
+    Each rank is processed on pool, or on a pool of getThreadCount()
+    threads the graph starts on its first propagation when it is nullptr.
+    A pool passed in must outlive the graph and may be shared by graphs
+    that do not propagate at the same time.
+     */
+    explicit AsGraph(std::pmr::memory_resource *resource = nullptr, ThreadPool *pool = nullptr)
+        : routeResource(resource != nullptr ? resource : &arena), pool(pool),
+          numThreads(std::max(1u, std::thread::hardware_concurrency())) {}
+
+    /*
+    Threads propagation runs on, the caller included (at least 1). Replaces
+    the current pool, also one passed to the constructor, with the graph's
+    own; the threads start on the next propagation. Results do not depend
+    on the count.
+     */
+    void setThreadCount(unsigned threads)
+    {
+        numThreads = std::max(1u, threads);
+        ownPool.reset();
+        pool = nullptr;
+    }
+
+    // threads the next propagation runs on
+    unsigned getThreadCount() const
+    {
+        return pool != nullptr ? static_cast<unsigned>(pool->size()) : numThreads;
+    }
+
+    // how ranks are cut into chunks, RankSplit::COST by default
+    void setRankSplit(RankSplit split)
+    {
+        rankSplit = split;
+    }
+
+    RankSplit getRankSplit() const
+    {
+        return rankSplit;
+    }
+
+    /*
+    Timing of every parallel step of the current propagation (since the last
+    propagateUp or clearRoutes), in order.
+    timing.criticalMs is the busiest thread of the step and
+    timing.workMs / getThreadCount() what a perfect split would take.
+     */
+    const vector<RankStats> &getRankStats() const
+    {
+        return rankStats;
+    }
+
+    // busy and idle time of each propagation thread (the caller first), empty before the first propagation
+    vector<ThreadStats> getThreadStats() const
+    {
+        return pool != nullptr ? pool->stats() : vector<ThreadStats>();
+    }
+
+    /*
+    Forgets every route so another scenario can be seeded on the same graph.
+    Relationships, ranks and the ROV deployment are kept. The graph's own
+    arena and path pool are reset in one step instead of freeing routes
+    one by one.
+     */
+    void clearRoutes();
+
+    // the pool the paths of this graph's routes are handles into
+    PathPool &getPathPool()
+    {
+        return paths;
+    }
+
+    const PathPool &getPathPool() const
+    {
+        return paths;
+    }
+
+    // bytes the graph's own arena handed out since the last clearRoutes
+    size_t arenaBytes()
+    {
+        return arena.bytesAllocated();
+    }
 
     /*
     Code that reads caida data and builds the AS graph.
+    The file is memory-mapped and parsed in place (see CaidaParser).
+    bzip2 or gzip compressed files are detected by their magic bytes and
+    decompressed in memory on a background thread while parsing.
+    With numThreads > 1 a plain text file is split into that many chunks which
+    are tokenized in parallel; the resulting graph is identical to the serial one.
+    Repeated relationships are stored once, and lines that contradict an
+    earlier line for the same pair are resolved with the conflict rule
+    (see setConflictRule and getIngestStats).
     Returns 0 on success, -1 on failure.
      */
-    int buildGraph(const string &fileName);
+    int buildGraph(const string &fileName, unsigned numThreads = 1);
 
-    const auto &getAsMap() const
+    // how buildGraph resolves conflicting lines, KEEP_FIRST by default
+    void setConflictRule(ConflictRule rule)
     {
-        return asMap;
+        conflictRule = rule;
+    }
+
+    // counts from the last buildGraph call
+    const IngestStats &getIngestStats() const
+    {
+        return ingestStats;
     }
 
-    const auto &getAdjacencyList() const
+    const auto &getAsMap() const
     {
-        return adjacencyList;
+        return asMap;
     }
 
+    /*
+    The graph as asn -> list of (neighbor_asn, relationship_type), built from
+    the CSR topology on every call: customers then peers of each AS, and only
+    ASes that have one. Peer edges show up on both sides. Incremental
+    updates are visible once commitUpdates ran.
+     */
+    unordered_map<int, vector<pair<int, RelationshipType>>> getAdjacencyList() const;
+
     const auto &getFlattenedGraph() const
     {
         return flattenedGraph;
     }
 
+    const Topology &getTopology() const
+    {
+        return topology;
+    }
+
+    // returns the dense index of an ASN, or -1 if it is not in the graph
+    long indexOf(int asn) const
+    {
+        auto it = asMap.find(asn);
+        return it == asMap.end() ? -1 : static_cast<long>(it->second->getIndex());
+    }
+
+    /*
+    Writes the edges, ROV deployment and propagation ranks to a versioned
+    binary snapshot (see GraphSnapshot.h). The graph is (re)flattened first.
+    Returns 0 on success, -1 on failure or if the graph has a cycle.
+     */
+    int saveSnapshot(const string &fileName);
+
+    /*
+    Loads a snapshot written by saveSnapshot into an empty graph. Replaces
+    buildGraph, loadROVDeployment and flattenGraph: the interned ASNs, the
+    CSR topology and the ranks are taken from the file as they are, and no
+    cycle check is needed. Every section is validated before the graph is
+    touched, so a corrupt file leaves it empty.
+    Returns 0 on success, -1 on failure.
+     */
+    int loadSnapshot(const string &fileName);
+
     // check for cycles in the graph (p->c relationships)
     bool hasCycle();
 
     // check individual nodes for cycles
     bool nodeHasCycle(int src);
 
-    // flatten graph into propagation ranks
-    void flattenGraph();
+    /*
+    Returns one provider->customer cycle as ASNs, starting and ending with the
+    same ASN (e.g. 1 -> 2 -> 3 -> 1), or an empty vector if the graph is acyclic.
+     */
+    vector<int> findCycle();
+
+    /*
+    Flattens the graph into propagation ranks: stubs are rank 0 and every
+    other AS is one above its highest customer. Each AS is ranked exactly
+    once, when its last customer is. If some ASes are never reached they
+    sit on or above a cycle: returns false and leaves the ranks empty, and
+    the cycle is available from getCycle().
+     */
+    bool flattenGraph();
+
+    const vector<int> &getCycle() const
+    {
+        return cycle;
+    }
+
+    /*
+    Incremental updates for CAIDA relationship diffs on a flattened graph
+    (after flattenGraph or loadSnapshot). Each call updates the AS neighbor
+    vectors in place, checks for a new cycle only around the changed edge,
+    and re-ranks only the ASes above it. The pair may be given in either
+    order for remove and retype. ASes are never deleted, one that loses its
+    last edge stays in the graph as an isolated stub.
+    Call commitUpdates once the whole diff is applied.
+    Return 0 on success, -1 if the edge is missing, the graph is not
+    flattened, or the change would create a cycle (see getCycle()); a
+    rejected change leaves the graph untouched.
+     */
+    int addRelationship(int srcAsn, int dstAsn, RelationshipType relType);
+    int removeRelationship(int srcAsn, int dstAsn);
+    int retypeRelationship(int srcAsn, int dstAsn, RelationshipType relType);
+
+    /*
+    Rebuilds the CSR topology and the rank buffers from the updated
+    neighbor vectors and ranks, so propagation sees the new edges.
+    This is one pass over the neighbor vectors, nothing is re-ranked.
+     */
+    void commitUpdates();
 
     // stores ASNs that are within rov_asns.csv
     int loadROVDeployment(const string &filename);
 
-    // processes announcements for nodes from anns.csv
+    /*
+    Forces a RIB layout for the next processInitialAnnouncements, AUTO (the
+    default) picks one from the seeded prefixes with DenseRibStore::chooseLayout.
+     */
+    void setRibLayout(RibLayout layout)
+    {
+        ribLayout = layout;
+    }
+
+    // layout the RIBs use after seeding, SPARSE before
+    RibLayout getRibLayout() const
+    {
+        return seededLayout;
+    }
+
+    // prefix ids seeded since the last clearRoutes, sorted
+    const vector<uint32_t> &getSeededPrefixIds() const
+    {
+        return seededIds;
+    }
+
+    /*
+    processes announcements for nodes from anns.csv
+
+    Before the origins are stored the RIB layout is chosen: dense rows when
+    most ASes are expected to hold a route for most seeded prefixes, per-AS
+    sorted vectors otherwise. Only the first seeding can switch to dense
+    rows, prefixes seeded later go to the sparse part of each RIB.
+     */
     void processInitialAnnouncements(const string &filename);
 
+    /*
+    PUSH (the default) or PULL. Both give the same RIBs: a receiver keeps
+    the best route per prefix whatever order they arrive in, and routes from
+    different neighbors never tie since the next hop is part of the rank.
+     */
+    void setPropagationEngine(PropagationEngine e)
+    {
+        engine = e;
+    }
+
+    PropagationEngine getPropagationEngine() const
+    {
+        return engine;
+    }
+
     // propagates customers announcements to providers
     void propagateUp();
 
-    // propagates peer-to-peer announcements
+    /*
+    propagates peer-to-peer announcements, with both engines every AS pulls
+    its peers' routes on the pool and then processes them
+     */
     void propagateAcross();
 
     // propagates provider announcements to customers
     void propagateDown();
+
+    /*
+    Prefix-sharded propagation, in place of propagateUp, propagateAcross and
+    propagateDown right after processInitialAnnouncements. Routes for
+    different prefixes never interact, so the seeded prefix ids are cut into
+    shards of equal count (shards = 0 picks four per pool thread) and every
+    shard runs the whole up/across/down sequence on one pool thread against
+    the shared read-only topology, with no per-rank barrier between
+    threads. Each shard keeps its own per-AS states; their routes are merged
+    into the RIBs once every shard is done. The RIBs are the same as with
+    the three phases.
+     */
+    void propagateByPrefix(size_t shards = 0);
+
+    /*
+    Indexes every interned prefix for longest-prefix matching. Call it after
+    propagateDown (or whenever new prefixes were seeded) and before
+    lookupRoutes.
+     */
+    void buildPrefixIndex();
+
+    const PrefixIndex &getPrefixIndex() const
+    {
+        return prefixIndex;
+    }
+
+    /*
+    Batched "which route does AS y use for address x": for every address (IPv4
+    or IPv6) and every ASN, the longest prefix in that AS's RIB containing the
+    address and its route. The result is row-major, addresses.size() rows of
+    asns.size() matches. An address that does not parse, an unknown ASN or an
+    AS without a covering route gives a match that is not found().
+     */
+    vector<RouteMatch> lookupRoutes(const vector<string> &addresses, const vector<int> &asns) const;
 };
@@ -2,22 +2,52 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <queue>
+#include <memory_resource>
+#include <algorithm>
 
 #include "Announcement.h"
+#include "Route.h"
 #include "Policy.h"
 
-using std::string, std::unordered_map, std::queue;
+using std::string, std::unordered_map;
 
 class BGP : public Policy
 {
 protected:
     int ownerAsn;
-    unordered_map<string, Announcement> localRib; // routing information table
-    queue<Announcement> receivedAnnouncements;    // contains all received announcements to be processed
+    PathPool *paths;   // where this AS's paths are interned, shared with the rest of its graph
+    LocalRib localRib; // routing information table, keyed by prefix id
+
+    /*
+    Best received route per prefix since the last processAnnouncements.
+    Incoming announcements are folded in with chooseBest as they arrive, so
+    losers are never stored. pendingSlot maps a prefix id to its position in
+    pending plus one (0 = nothing pending), it is reset entry by entry after
+    every process so it keeps its size across phases.
+    Both draw from the same memory resource as localRib.
+     */
+    std::pmr::vector<Route> pending;
+    std::pmr::vector<uint32_t> pendingSlot;
+
+    // slot of the pending candidate for prefixId, nullptr if there is none
+    Route *pendingFor(uint32_t prefixId)
+    {
+        if (prefixId >= pendingSlot.size() || pendingSlot[prefixId] == 0)
+        {
+            return nullptr;
+        }
+        return &pending[pendingSlot[prefixId] - 1];
+    }
+
 
 public:
-    BGP(int asn)
+    /*
+    RIB and pending storage come from resource and paths are interned into
+    paths, e.g. an AsGraph's RunArena and PathPool
+     */
+    BGP(int asn, std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+        PathPool *paths = &PathPool::global())
+        : paths(paths), localRib(resource, *paths), pending(resource), pendingSlot(resource)
     {
         this->ownerAsn = asn;
     }
@@ -27,20 +57,87 @@ public:
         return ownerAsn;
     }
 
+    // both forward the packed route, its path interned into this AS's pool, to enqueueRoute
     void enqueueAnnouncement(const Announcement &a) override;
-    void enqueueAnnouncement(Announcement &&a);  
+    void enqueueAnnouncement(Announcement &&a);
+
+    /*
+    Keeps r as the pending candidate for its prefix if it beats the current one.
+    Defined here so the propagation loops can inline BGP::enqueueRoute.
+     */
+    void enqueueRoute(const Route &r) override
+    {
+        uint32_t prefixId = r.getPrefixId();
+        Route *curr = pendingFor(prefixId);
+        if (curr == nullptr)
+        {
+            if (prefixId >= pendingSlot.size())
+            {
+                pendingSlot.resize(prefixId + 1, 0);
+            }
+            pending.push_back(r);
+            pendingSlot[prefixId] = static_cast<uint32_t>(pending.size());
+            return;
+        }
+
+        // ties keep the earlier candidate, the same order the old inbox was scanned in
+        if (chooseBest(curr, &r) != curr)
+        {
+            *curr = r;
+        }
+    }
 
     void processAnnouncements() override;
 
-    const unordered_map<string, Announcement> &getlocalRib() const override
+    // prefixes with a pending candidate, the work the next processAnnouncements has
+    size_t pendingCount() const
+    {
+        return pending.size();
+    }
+
+    const LocalRib &getlocalRib() const override
     {
         return localRib;
     }
 
-    Announcement *chooseBest(Announcement *a1, Announcement *a2);
+    void useDenseRib(Route *row, uint8_t *present, uint32_t width) override
+    {
+        localRib.attachDenseRow(row, present, width);
+        /*
+        dense means most prefixes reach this AS, so size the pending storage
+        once instead of doubling it (an arena never reuses the old buffers)
+         */
+        pending.reserve(width);
+        pendingSlot.resize(std::max<size_t>(pendingSlot.size(), width), 0);
+    }
+
+    void clearRoutes() override
+    {
+        localRib.clear();
+        std::pmr::vector<Route>(pending.get_allocator()).swap(pending);
+        std::pmr::vector<uint32_t>(pendingSlot.get_allocator()).swap(pendingSlot);
+    }
+
+    // see Route::chooseBest
+    const Route *chooseBest(const Route *curr, const Route *cand) const
+    {
+        return Route::chooseBest(curr, cand);
+    }
 
     void addOrigin(const Announcement &a) override
     {
-        localRib[a.getPrefix()] = a;
+        localRib.store(a.routeIn(*paths));
+    }
+
+    // the pool the stored and pending routes' paths live in
+    PathPool &getPathPool() const
+    {
+        return *paths;
+    }
+
+    // stores a route this AS selected elsewhere (a prefix shard) as is, its path must live in getPathPool()
+    void adoptRoute(const Route &r)
+    {
+        localRib.store(r);
     }
 };
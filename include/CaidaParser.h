@@ -0,0 +1,212 @@
+#pragma once
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "MappedFile.h"
+#include "DecompressStream.h"
+#include "Relationships.h"
+
+using std::string, std::vector, std::thread;
+
+// one parsed line of an as-rel2 file
+struct CaidaEdge
+{
+    int src;
+    int dst;
+    RelationshipType relType;
+};
+
+class CaidaParser
+{
+private:
+    // returns the first character of the next line (or end)
+    static const char *skipLine(const char *pos, const char *end)
+    {
+        const char *nl = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        return nl == nullptr ? end : nl + 1;
+    }
+
+    // parses "<int>|" starting at pos, returns nullptr if the field is malformed
+    static const char *parseField(const char *pos, const char *end, int &value)
+    {
+        auto res = std::from_chars(pos, end, value);
+        if (res.ec != std::errc() || res.ptr == end)
+        {
+            return nullptr;
+        }
+        return res.ptr;
+    }
+
+public:
+    /*
+    Scans CAIDA as-rel2 data in place and calls emit(src, dst, relType) for every edge.
+
+    ex line: 51823|198047|0|mlp
+
+            51823 - src
+            198047 - dst
+            0 - relationship type
+            mlp - ignored (never looked at)
+
+    Lines starting with '#' and empty lines are skipped, as are lines whose
+    first three fields are not integers. No strings are built along the way.
+    Returns the number of edges emitted.
+     */
+    template <typename EmitFn>
+    static size_t parse(const char *begin, const char *end, EmitFn &&emit)
+    {
+        size_t edges = 0;
+        const char *pos = begin;
+        while (pos < end)
+        {
+            if (*pos == '#' || *pos == '\n' || *pos == '\r')
+            {
+                pos = skipLine(pos, end);
+                continue;
+            }
+
+            int src, dst, rel;
+            const char *p = parseField(pos, end, src);
+            if (p != nullptr && *p == '|')
+                p = parseField(p + 1, end, dst);
+            else
+                p = nullptr;
+            if (p != nullptr && *p == '|')
+            {
+                auto res = std::from_chars(p + 1, end, rel);
+                p = (res.ec == std::errc()) ? res.ptr : nullptr;
+            }
+            else
+                p = nullptr;
+
+            if (p != nullptr)
+            {
+                emit(src, dst, static_cast<RelationshipType>(rel));
+                ++edges;
+            }
+            pos = skipLine(p != nullptr ? p : pos, end);
+        }
+        return edges;
+    }
+
+    /*
+    Splits [begin, end) at line boundaries into numThreads chunks and parses
+    each chunk on its own thread into its own edge buffer.
+
+    Buffers are returned in file order, so replaying them front to back
+    emits exactly the edges parse() would, in the same order.
+     */
+    static vector<vector<CaidaEdge>> parseChunks(const char *begin, const char *end, unsigned numThreads)
+    {
+        if (numThreads == 0)
+            numThreads = 1;
+
+        // chunk i covers [bounds[i], bounds[i + 1]), every bound sits at a line start
+        size_t total = end - begin;
+        vector<const char *> bounds(numThreads + 1, end);
+        bounds[0] = begin;
+        for (unsigned i = 1; i < numThreads; ++i)
+        {
+            const char *guess = begin + total / numThreads * i;
+            if (guess < bounds[i - 1])
+                guess = bounds[i - 1];
+            bounds[i] = (guess == begin) ? begin : skipLine(guess - 1, end);
+        }
+
+        vector<vector<CaidaEdge>> buffers(numThreads);
+        vector<thread> workers;
+        workers.reserve(numThreads);
+        for (unsigned i = 0; i < numThreads; ++i)
+        {
+            workers.emplace_back([&, i]
+                                 {
+                vector<CaidaEdge> &out = buffers[i];
+                // rough guess of ~16 bytes per line to avoid most regrowth
+                out.reserve((bounds[i + 1] - bounds[i]) / 16);
+                parse(bounds[i], bounds[i + 1], [&out](int src, int dst, RelationshipType rel)
+                      { out.push_back({src, dst, rel}); }); });
+        }
+        for (thread &t : workers)
+        {
+            t.join();
+        }
+        return buffers;
+    }
+
+    /*
+    Streams a bzip2 or gzip compressed file through a DecompressStream and
+    parses the decompressed blocks as they arrive, so decompression of the
+    next block overlaps with parsing of the current one. Lines that straddle
+    two blocks are carried over. Nothing is written to disk.
+    Returns the number of edges emitted, or -1 if the file could not be opened
+    or is not valid compressed data. A stream that breaks off partway has
+    already emitted the edges before the error, so callers that must not
+    keep them should buffer until this returns.
+     */
+    template <typename EmitFn>
+    static long parseCompressedFile(const string &fileName, Compression compression, EmitFn &&emit,
+                                    size_t blockSize = 1 << 20)
+    {
+        DecompressStream stream(blockSize);
+        if (!stream.open(fileName, compression))
+        {
+            return -1;
+        }
+
+        size_t edges = 0;
+        string carry; // partial line left over from the previous block
+        vector<char> block;
+        while (stream.next(block))
+        {
+            const char *begin = block.data();
+            const char *end = begin + block.size();
+
+            // everything after the last newline continues in the next block
+            const char *lastLineEnd = end;
+            while (lastLineEnd > begin && lastLineEnd[-1] != '\n')
+                --lastLineEnd;
+
+            if (lastLineEnd == begin)
+            {
+                carry.append(begin, end);
+                continue;
+            }
+
+            if (!carry.empty())
+            {
+                const char *firstLineEnd = static_cast<const char *>(memchr(begin, '\n', end - begin)) + 1;
+                carry.append(begin, firstLineEnd);
+                edges += parse(carry.data(), carry.data() + carry.size(), emit);
+                carry.clear();
+                begin = firstLineEnd;
+            }
+            edges += parse(begin, lastLineEnd, emit);
+            carry.assign(lastLineEnd, end);
+        }
+        edges += parse(carry.data(), carry.data() + carry.size(), emit);
+
+        if (stream.hasError())
+        {
+            return -1;
+        }
+        return static_cast<long>(edges);
+    }
+
+    /*
+    Memory-maps the file and parses it with parse().
+    Returns the number of edges emitted, or -1 if the file could not be opened.
+     */
+    template <typename EmitFn>
+    static long parseFile(const string &fileName, EmitFn &&emit)
+    {
+        MappedFile file;
+        if (!file.open(fileName))
+        {
+            return -1;
+        }
+        return static_cast<long>(parse(file.begin(), file.end(), std::forward<EmitFn>(emit)));
+    }
+};
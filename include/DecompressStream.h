@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using std::string, std::vector, std::deque, std::thread, std::mutex, std::condition_variable;
+
+enum class Compression
+{
+    NONE,
+    BZIP2,
+    GZIP
+};
+
+/*
+Detects the compression of a file from its magic bytes ("BZh" for bzip2,
+1f 8b for gzip). Missing or unreadable files report NONE.
+ */
+Compression detectCompression(const string &fileName);
+
+/*
+Producer/consumer decompression pipeline.
+
+open() starts a producer thread that reads and decompresses the file into
+fixed-size blocks and queues them; the consumer pulls blocks with next()
+while the producer keeps decompressing ahead. At most maxQueued blocks are
+in flight, and drained buffers are recycled instead of reallocated.
+ */
+class DecompressStream
+{
+private:
+    size_t blockSize;
+    size_t maxQueued;
+
+    thread producer;
+    mutex lock;
+    condition_variable blockReady; // signalled when a block is queued or the producer finishes
+    condition_variable slotFree;   // signalled when the consumer drains a block
+    deque<vector<char>> full;      // decompressed blocks waiting for the consumer
+    vector<vector<char>> spare;    // drained buffers the producer can reuse
+    bool done = false;             // producer has queued its last block
+    bool failed = false;           // producer hit a read or decompression error
+    bool stopping = false;         // consumer is going away, producer should quit
+
+    void produce(string fileName, Compression compression);
+
+    // returns an empty buffer of blockSize capacity, false if the consumer stopped
+    bool acquireBuffer(vector<char> &buffer);
+
+    // queues a filled buffer, false if the consumer stopped
+    bool pushBlock(vector<char> &&buffer);
+
+    void finish(bool error);
+
+public:
+    DecompressStream(size_t blockSize = 1 << 20, size_t maxQueued = 4)
+        : blockSize(blockSize), maxQueued(maxQueued) {}
+
+    ~DecompressStream();
+
+    DecompressStream(const DecompressStream &) = delete;
+    DecompressStream &operator=(const DecompressStream &) = delete;
+
+    // starts decompressing in the background, false if the file cannot be opened
+    bool open(const string &fileName, Compression compression);
+
+    /*
+    Blocks until the next decompressed block is available and swaps it into
+    block (the previous contents of block are recycled).
+    Returns false once the whole file has been delivered or on error.
+     */
+    bool next(vector<char> &block);
+
+    // whether decompression stopped because of a read or format error
+    bool hasError();
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+/*
+On-disk layout of an AsGraph snapshot (native byte order).
+
+    SnapshotHeader
+    int32_t   asns[asCount]              dense AS index -> ASN
+    uint32_t  providerOffsets[asCount + 1]
+    uint32_t  providerNeighbors[...]     the CSR arrays of Topology, as is
+    uint32_t  customerOffsets[asCount + 1]
+    uint32_t  customerNeighbors[...]
+    uint32_t  peerOffsets[asCount + 1]
+    uint32_t  peerNeighbors[...]
+    uint32_t  rankIndices[asCount]       dense indices grouped by rank, rank 0 first
+    uint32_t  rankOffsets[rankCount + 1] rank r is rankIndices[rankOffsets[r] .. rankOffsets[r + 1])
+    uint64_t  rovBitmap[(asCount + 63) / 64]
+                                         bit i set means AS index i deploys ROV
+
+Every section starts on an 8 byte boundary so it can be read in place
+from a read-only mapping. Loading validates the sections in place, copies
+the ASNs, CSR and rank arrays out of the mapping (one bulk copy each, the
+topology owns its arrays), and fills the per-AS neighbor vectors that
+incremental updates edit from the CSR arrays (one push per edge). It skips
+parsing, duplicate/conflict handling, the CSR build and ranking. Snapshots
+are only written for acyclic graphs, so loading one skips cycle detection.
+ */
+
+static constexpr char SNAPSHOT_MAGIC[8] = {'A', 'S', 'G', 'R', 'A', 'P', 'H', '\0'};
+static constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+// where one array starts in the file and how many elements it has
+struct SnapshotSection
+{
+    uint64_t offset;
+    uint64_t count;
+};
+
+// the sections in file order, see SnapshotHeader::sections
+enum SnapshotSectionId
+{
+    SNAP_ASNS,
+    SNAP_PROVIDER_OFFSETS,
+    SNAP_PROVIDER_NEIGHBORS,
+    SNAP_CUSTOMER_OFFSETS,
+    SNAP_CUSTOMER_NEIGHBORS,
+    SNAP_PEER_OFFSETS,
+    SNAP_PEER_NEIGHBORS,
+    SNAP_RANK_INDICES,
+    SNAP_RANK_OFFSETS,
+    SNAP_ROV_BITMAP,
+    SNAP_SECTION_COUNT
+};
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t asCount;
+    uint64_t rankCount;
+    uint64_t fileSize;
+    SnapshotSection sections[SNAP_SECTION_COUNT];
+};
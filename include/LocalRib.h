@@ -0,0 +1,371 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <optional>
+#include <algorithm>
+#include <memory_resource>
+
+#include "Announcement.h"
+#include "Route.h"
+#include "PrefixTable.h"
+
+using std::string, std::vector;
+
+// one RIB entry as seen from outside: the prefix string is only looked up here
+struct RibEntry
+{
+    const string &first; // prefix
+    Announcement second; // best route for it, a façade over the stored Route
+};
+
+enum class RibLayout
+{
+    AUTO,   // let AsGraph pick with DenseRibStore::chooseLayout
+    SPARSE, // per-AS vector sorted by prefix id
+    DENSE   // per-AS row of a DenseRibStore, one slot per prefix id
+};
+
+/*
+Routing table of one AS, keyed by interned prefix id. Routes are stored
+packed (Route, 16 bytes) and handed out as Announcement.
+
+Routes live either in a small vector sorted by prefix id (sparse, the
+default) or in a row of a DenseRibStore, one slot per prefix id (dense).
+A dense RIB keeps prefix ids past its row width in the sparse vector, so
+any id can be stored in either layout.
+
+The sparse vector draws from the memory resource given at construction
+(AsGraph passes its RunArena), and the stored paths are handles into the
+PathPool given with it (the graph's own), which the Announcements handed
+out resolve them against.
+
+The propagation code uses the id based calls (findId, store). find, at and
+iteration take and yield prefix strings, so output code and tests can keep
+treating it like the old unordered_map<string, Announcement>.
+ */
+class LocalRib
+{
+private:
+    std::pmr::vector<Route> sparse; // sorted by prefix id
+    Route *denseRow = nullptr;
+    uint8_t *densePresent = nullptr; // 1 if the slot holds a route
+    uint32_t denseWidth = 0;
+    size_t count = 0;
+    PathPool *paths; // where the stored routes' paths live
+
+    std::pmr::vector<Route>::iterator sparseSlot(uint32_t prefixId)
+    {
+        return std::lower_bound(sparse.begin(), sparse.end(), prefixId, [](const Route &r, uint32_t id)
+                                { return r.getPrefixId() < id; });
+    }
+
+    std::pmr::vector<Route>::const_iterator sparseSlot(uint32_t prefixId) const
+    {
+        return std::lower_bound(sparse.begin(), sparse.end(), prefixId, [](const Route &r, uint32_t id)
+                                { return r.getPrefixId() < id; });
+    }
+
+public:
+    explicit LocalRib(std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+                      PathPool &paths = PathPool::global())
+        : sparse(resource), paths(&paths) {}
+
+    // a dense row belongs to one RIB, copying would alias it
+    LocalRib(const LocalRib &) = delete;
+    LocalRib &operator=(const LocalRib &) = delete;
+
+    /*
+    Walks the dense slots that hold a route, then the sparse vector.
+    Positions below denseWidth are dense slots, the rest index sparse.
+     */
+    class const_iterator
+    {
+    private:
+        const LocalRib *rib;
+        size_t pos;
+        mutable std::optional<RibEntry> current; // entry handed out by the last dereference
+
+        void skipEmpty()
+        {
+            while (pos < rib->denseWidth && !rib->densePresent[pos])
+            {
+                ++pos;
+            }
+        }
+
+    public:
+        const_iterator(const LocalRib *rib, size_t pos) : rib(rib), pos(pos)
+        {
+            skipEmpty();
+        }
+
+        const_iterator(const const_iterator &other) : rib(other.rib), pos(other.pos) {}
+
+        const_iterator &operator=(const const_iterator &other)
+        {
+            rib = other.rib;
+            pos = other.pos;
+            current.reset();
+            return *this;
+        }
+
+        const Route &route() const
+        {
+            return pos < rib->denseWidth ? rib->denseRow[pos] : rib->sparse[pos - rib->denseWidth];
+        }
+
+        uint32_t prefixId() const
+        {
+            return route().getPrefixId();
+        }
+
+        // valid until the iterator moves on
+        const RibEntry &operator*() const
+        {
+            const Route &r = route();
+            current.emplace(RibEntry{PrefixTable::global().get(r.getPrefixId()), Announcement(r, *rib->paths)});
+            return *current;
+        }
+
+        const RibEntry *operator->() const
+        {
+            return &**this;
+        }
+
+        const_iterator &operator++()
+        {
+            ++pos;
+            skipEmpty();
+            current.reset();
+            return *this;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return pos == other.pos;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return pos != other.pos;
+        }
+    };
+
+    /*
+    Switches to the dense layout on a row of width slots (slots and present
+    flags owned by a DenseRibStore). Routes already stored move into the row.
+     */
+    void attachDenseRow(Route *row, uint8_t *present, uint32_t width)
+    {
+        denseRow = row;
+        densePresent = present;
+        denseWidth = width;
+
+        std::pmr::vector<Route> overflow(sparse.get_allocator());
+        for (const Route &r : sparse)
+        {
+            uint32_t id = r.getPrefixId();
+            if (id < width)
+            {
+                denseRow[id] = r;
+                densePresent[id] = 1;
+            }
+            else
+            {
+                overflow.push_back(r);
+            }
+        }
+        sparse = std::move(overflow);
+    }
+
+    // drops every route and the dense row, without keeping any capacity
+    void clear()
+    {
+        std::pmr::vector<Route>(sparse.get_allocator()).swap(sparse);
+        denseRow = nullptr;
+        densePresent = nullptr;
+        denseWidth = 0;
+        count = 0;
+    }
+
+    RibLayout getLayout() const
+    {
+        return denseRow != nullptr ? RibLayout::DENSE : RibLayout::SPARSE;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, denseWidth + sparse.size());
+    }
+
+    // calls fn(route) for every stored Route, skipping the Announcement façade
+    template <typename Fn>
+    void forEachRoute(Fn &&fn) const
+    {
+        for (uint32_t id = 0; id < denseWidth; ++id)
+        {
+            if (densePresent[id])
+            {
+                fn(denseRow[id]);
+            }
+        }
+        for (const Route &r : sparse)
+        {
+            fn(r);
+        }
+    }
+
+    // calls fn(route) for every stored Route with a prefix id of at least firstId
+    template <typename Fn>
+    void forEachRouteFrom(uint32_t firstId, Fn &&fn) const
+    {
+        for (uint32_t id = firstId; id < denseWidth; ++id)
+        {
+            if (densePresent[id])
+            {
+                fn(denseRow[id]);
+            }
+        }
+        for (auto it = sparseSlot(firstId); it != sparse.end(); ++it)
+        {
+            fn(*it);
+        }
+    }
+
+    // prefix ids below this have a dense slot, 0 for a sparse RIB
+    uint32_t getDenseWidth() const
+    {
+        return denseWidth;
+    }
+
+    const_iterator find(const string &prefix) const
+    {
+        uint32_t id = PrefixTable::global().find(prefix);
+        if (id == PrefixTable::NOT_FOUND || findId(id) == nullptr)
+        {
+            return end();
+        }
+        if (id < denseWidth)
+        {
+            return const_iterator(this, id);
+        }
+        return const_iterator(this, denseWidth + (sparseSlot(id) - sparse.begin()));
+    }
+
+    // a copy of the route, bind it to a const reference or a value
+    Announcement at(const string &prefix) const
+    {
+        auto it = find(prefix);
+        if (it == end())
+        {
+            throw std::out_of_range("no route for " + prefix);
+        }
+        return Announcement(it.route(), *paths);
+    }
+
+    // route for a prefix id, nullptr if there is none
+    const Route *findId(uint32_t prefixId) const
+    {
+        if (prefixId < denseWidth)
+        {
+            return densePresent[prefixId] ? &denseRow[prefixId] : nullptr;
+        }
+        auto it = sparseSlot(prefixId);
+        return it != sparse.end() && it->getPrefixId() == prefixId ? &*it : nullptr;
+    }
+
+    // inserts or replaces the route for its prefix
+    void store(const Route &r)
+    {
+        uint32_t prefixId = r.getPrefixId();
+        if (prefixId < denseWidth)
+        {
+            denseRow[prefixId] = r;
+            count += densePresent[prefixId] == 0;
+            densePresent[prefixId] = 1;
+            return;
+        }
+
+        auto it = sparseSlot(prefixId);
+        if (it != sparse.end() && it->getPrefixId() == prefixId)
+        {
+            *it = r;
+            return;
+        }
+        sparse.insert(it, r);
+        ++count;
+    }
+};
+
+/*
+Backing memory for dense RIBs: one row of width slots per AS, so the RIB
+of AS index i for prefix id p is slot i * width + p. Worth it when most
+ASes end up with a route for most prefixes, which is the normal outcome of
+propagating a handful of prefixes over a connected graph.
+ */
+class DenseRibStore
+{
+private:
+    vector<Route> slots;
+    vector<uint8_t> present;
+    uint32_t width = 0;
+
+public:
+    // dense rows are only used when the table stays under this many slots
+    static constexpr size_t MAX_DENSE_SLOTS = size_t(1) << 28;
+
+    /*
+    Picks the RIB layout for rows ASes and prefix ids below width, given
+    how many routes per AS propagation is expected to leave (expectedRoutes).
+    Dense pays off once at least half of the slots will be filled.
+     */
+    static RibLayout chooseLayout(size_t rows, uint32_t width, double expectedRoutes)
+    {
+        if (rows == 0 || width == 0 || rows * width > MAX_DENSE_SLOTS)
+        {
+            return RibLayout::SPARSE;
+        }
+        return expectedRoutes * 2 >= width ? RibLayout::DENSE : RibLayout::SPARSE;
+    }
+
+    // rows of newWidth empty slots, reset(0, 0) frees the table
+    void reset(size_t rows, uint32_t newWidth)
+    {
+        width = newWidth;
+        vector<Route>(rows * width).swap(slots);
+        vector<uint8_t>(rows * width, 0).swap(present);
+    }
+
+    uint32_t getWidth() const
+    {
+        return width;
+    }
+
+    Route *row(size_t index)
+    {
+        return slots.data() + index * width;
+    }
+
+    uint8_t *presentRow(size_t index)
+    {
+        return present.data() + index * width;
+    }
+};
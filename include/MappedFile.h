@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+using std::string;
+
+class MappedFile
+{
+private:
+    const char *data = nullptr; // start of the read-only mapping
+    size_t length = 0;          // size of the mapping in bytes
+    bool mapped = false;        // whether munmap is needed on close
+
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /*
+    Maps the whole file read-only into memory.
+    Returns true on success, false if the file could not be opened or mapped.
+     */
+    bool open(const string &fileName);
+
+    void close();
+
+    const char *begin() const
+    {
+        return data;
+    }
+
+    const char *end() const
+    {
+        return data + length;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+};
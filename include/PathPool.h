@@ -0,0 +1,173 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+
+using std::vector, std::mutex, std::atomic, std::unique_ptr;
+
+/*
+4-byte reference to an AS path in a PathPool, the default is the empty path.
+Only the pool creates non-empty handles (and the member is private so a
+braced ASN list never converts to a handle by accident).
+ */
+class PathHandle
+{
+private:
+    friend class PathPool;
+    uint32_t node = 0;
+
+    static PathHandle fromNode(uint32_t node)
+    {
+        PathHandle handle;
+        handle.node = node;
+        return handle;
+    }
+
+public:
+    // index of the first path node, 0 for the empty path
+    uint32_t getNode() const
+    {
+        return node;
+    }
+
+    bool operator==(const PathHandle &other) const
+    {
+        return node == other.node;
+    }
+
+    bool operator!=(const PathHandle &other) const
+    {
+        return node != other.node;
+    }
+};
+
+// one hop of an interned path: asn followed by the path at parent
+struct PathNode
+{
+    int asn;
+    uint32_t parent; // node of the rest of the path
+    uint32_t length; // number of ASNs from this node to the end
+};
+
+/*
+Hash-consed storage for AS paths.
+
+A path is a chain of immutable nodes (first ASN + handle of the rest of
+the path), so prepending an ASN is one node and every announcement that
+shares a suffix shares its nodes. The length is cached in every node, so
+comparing path lengths is O(1). Handles only mean something to the pool
+that made them.
+
+Every AsGraph owns one for its routes. Announcements and policies made
+outside a graph (tests, tools) use global().
+
+prepend and intern may be called from several threads at once without
+taking a lock. Nodes are handed out with one atomic increment from
+fixed-size chunks that never move, and every thread interns through its
+own (asn, rest) index, found the way RunArena finds a thread's buffer.
+So identical paths built on one thread share a handle; the same path
+built on two threads may get two. Nodes live until reset(), which an
+AsGraph calls from clearRoutes so repeated runs do not grow the pool.
+ */
+class PathPool
+{
+private:
+    static constexpr uint32_t CHUNK_BITS = 16;
+    static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    static constexpr uint32_t MAX_CHUNKS = 1u << 16;
+
+    // open addressing table of node ids, 0 marks an empty slot, only touched by owner
+    struct ThreadIndex
+    {
+        std::thread::id owner;
+        vector<uint32_t> slots;
+        size_t used = 0;
+    };
+
+    unique_ptr<atomic<PathNode *>[]> chunks;
+    atomic<uint32_t> nextNode{1};
+    mutex lock;                              // guards indexes
+    vector<unique_ptr<ThreadIndex>> indexes; // one per thread that prepended
+    atomic<uint64_t> generation;             // unique across all pools, changes on every reset
+
+    // the index the calling thread used last, valid while its pool keeps that generation
+    struct CachedIndex
+    {
+        uint64_t generation = 0;
+        ThreadIndex *index = nullptr;
+    };
+    static thread_local CachedIndex cached;
+
+    static uint64_t nextGeneration();
+
+    static uint64_t hashHop(int asn, uint32_t parent);
+
+    PathNode &nodeAt(uint32_t id) const
+    {
+        return chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE - 1)];
+    }
+
+    // the calling thread's index, created on its first prepend
+    ThreadIndex &threadIndex();
+
+    uint32_t allocate(int asn, uint32_t parent);
+
+    void grow(ThreadIndex &index);
+
+public:
+    PathPool();
+    ~PathPool();
+
+    PathPool(const PathPool &) = delete;
+    PathPool &operator=(const PathPool &) = delete;
+
+    // the pool of announcements and policies created outside an AsGraph
+    static PathPool &global();
+
+    // handle of asn followed by path, reusing the node if this thread already made it
+    PathHandle prepend(int asn, PathHandle path);
+
+    // handle of a whole path given as a vector (first element is the most recent hop)
+    PathHandle intern(const vector<int> &path);
+
+    uint32_t length(PathHandle path) const
+    {
+        return nodeAt(path.node).length;
+    }
+
+    // the ASN at the front of the path, path must not be empty
+    int first(PathHandle path) const
+    {
+        return nodeAt(path.node).asn;
+    }
+
+    // calls fn(asn) for every hop, most recent hop first
+    template <typename Fn>
+    void walk(PathHandle path, Fn &&fn) const
+    {
+        for (uint32_t id = path.node; id != 0;)
+        {
+            const PathNode &node = nodeAt(id);
+            fn(node.asn);
+            id = node.parent;
+        }
+    }
+
+    vector<int> toVector(PathHandle path) const;
+
+    // drops every path but the empty one, all other handles are invalid afterwards
+    void reset();
+
+    // interned nodes, including the empty path
+    size_t size() const
+    {
+        return nextNode.load(std::memory_order_relaxed);
+    }
+
+    // bytes held by node chunks and thread indexes, call it while no thread prepends
+    size_t memoryBytes();
+};
@@ -3,8 +3,18 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <cstdint>
 
 #include "Announcement.h"
+#include "LocalRib.h"
+#include "Route.h"
+
+// which Policy implementation an AS runs, kept in a dense per-AS array by AsGraph
+enum class PolicyKind : uint8_t
+{
+    BGP = 0,
+    ROV = 1
+};
 
 class Policy
 {
@@ -14,9 +24,18 @@ public:
 
     virtual void enqueueAnnouncement(const Announcement &a) = 0;
 
+    // what propagation calls, the route is already packed
+    virtual void enqueueRoute(const Route &r) = 0;
+
     virtual void processAnnouncements() = 0;
 
     virtual void addOrigin(const Announcement &a) = 0;
 
-    virtual const std::unordered_map<std::string, Announcement> &getlocalRib() const = 0;
+    virtual const LocalRib &getlocalRib() const = 0;
+
+    // moves the RIB onto a dense row (see LocalRib::attachDenseRow)
+    virtual void useDenseRib(Route *row, uint8_t *present, uint32_t width) = 0;
+
+    // forgets every route and pending announcement, releasing their memory
+    virtual void clearRoutes() = 0;
 };
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PrefixTable.h"
+
+using std::string, std::vector;
+
+// an IPv4 or IPv6 address or prefix, left aligned in 128 bits
+struct IpAddress
+{
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+    bool v6 = false;
+
+    // bit i counted from the most significant one
+    int bit(uint32_t i) const
+    {
+        return static_cast<int>(((i < 64 ? hi >> (63 - i) : lo >> (127 - i))) & 1);
+    }
+};
+
+/*
+Longest-prefix-match index over the prefixes of a PrefixTable.
+
+One path-compressed binary radix trie per address family: every node
+stores the bits it covers (key, length), the prefix id when the node is a
+prefix itself, and two children. A lookup walks down from the root and
+collects every prefix containing the address, so nested prefixes come back
+longest first.
+
+The table interns prefix strings as written, so 10.1.2.3/16 and
+10.1.0.0/16 are two ids (and two RIB entries) for one trie node. The node
+keeps the lowest id and the others are chained behind it in sameAs, so a
+lookup returns all of them, lowest id first.
+
+Built once after propagation (AsGraph::buildPrefixIndex), read-only after,
+so lookups from several threads are safe. Prefix strings that do not parse
+are skipped and counted.
+ */
+class PrefixIndex
+{
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node
+    {
+        IpAddress key;            // first length bits are the node's prefix, the rest is zero
+        uint32_t length = 0;      // bits covered from the root
+        uint32_t prefixId = NONE; // lowest interned prefix ending here, NONE for a branch-only node
+        uint32_t child[2] = {NONE, NONE};
+    };
+
+    vector<Node> nodes;
+    vector<uint32_t> sameAs;          // by prefix id, the next id written for the same prefix, NONE at the end
+    uint32_t roots[2] = {NONE, NONE}; // IPv4, IPv6
+    size_t prefixCount = 0;
+    size_t skipped = 0;
+
+    uint32_t newNode(const IpAddress &key, uint32_t length, uint32_t prefixId);
+
+    void insert(const IpAddress &key, uint32_t length, uint32_t prefixId);
+
+public:
+    // "a.b.c.d" or an IPv6 address, false if it is neither
+    static bool parseAddress(const string &text, IpAddress &address);
+
+    // "address/length", false if the address or length is invalid
+    static bool parsePrefix(const string &text, IpAddress &address, uint32_t &length);
+
+    // indexes every prefix interned in table so far
+    void build(const PrefixTable &table);
+
+    void clear();
+
+    /*
+    Appends the ids of every indexed prefix containing address to matches,
+    longest prefix first.
+     */
+    void matches(const IpAddress &address, vector<uint32_t> &matches) const;
+
+    // prefix ids in the index, spellings of the same prefix counted apart
+    size_t size() const
+    {
+        return prefixCount;
+    }
+
+    // prefix strings build could not parse
+    size_t skippedCount() const
+    {
+        return skipped;
+    }
+};
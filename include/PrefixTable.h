@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <unordered_map>
+
+using std::string, std::deque, std::unordered_map;
+
+/*
+Global prefix interning: every prefix string gets a dense 32-bit id the
+first time it is seen, and announcements and RIBs only carry the id.
+The string is looked up again when output is written.
+
+Interning is not synchronized. Prefixes are interned while seeding
+(processInitialAnnouncements) and propagation only reads, so lookups from
+the propagation threads are safe.
+ */
+class PrefixTable
+{
+private:
+    deque<string> prefixes;              // id -> prefix, deque keeps references stable
+    unordered_map<string, uint32_t> ids; // prefix -> id
+
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    // the table shared by every announcement in the process
+    static PrefixTable &global()
+    {
+        static PrefixTable table;
+        return table;
+    }
+
+    // returns the id of prefix, assigning the next one if it is new
+    uint32_t intern(const string &prefix)
+    {
+        auto [it, inserted] = ids.try_emplace(prefix, static_cast<uint32_t>(prefixes.size()));
+        if (inserted)
+        {
+            prefixes.push_back(prefix);
+        }
+        return it->second;
+    }
+
+    // id of an already interned prefix, NOT_FOUND otherwise
+    uint32_t find(const string &prefix) const
+    {
+        auto it = ids.find(prefix);
+        return it == ids.end() ? NOT_FOUND : it->second;
+    }
+
+    const string &get(uint32_t id) const
+    {
+        return prefixes[id];
+    }
+
+    size_t size() const
+    {
+        return prefixes.size();
+    }
+};
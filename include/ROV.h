@@ -12,24 +12,18 @@ using std::string, std::unordered_map;
 class ROV : public BGP
 {
 public:
-    ROV(int asn) : BGP(asn) {}
+    ROV(int asn, std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+        PathPool *paths = &PathPool::global())
+        : BGP(asn, resource, paths) {}
 
-    void enqueueAnnouncement(const Announcement &a) override
+    // every enqueueAnnouncement overload ends up here
+    void enqueueRoute(const Route &r) override
     {
-        if (a.isRovInvalid())
-        {
-            return;
-        }
-        BGP::enqueueAnnouncement(a);
-    }
-    
-    void enqueueAnnouncement(Announcement &&a)
-    {
-        if (a.isRovInvalid())
+        if (r.isRovInvalid())
         {
             return;
         }
-        BGP::enqueueAnnouncement(std::move(a));
+        BGP::enqueueRoute(r);
     }
 
     void processAnnouncements() override
@@ -46,7 +40,7 @@ public:
         BGP::addOrigin(a);
     }
 
-    const unordered_map<string, Announcement> &getlocalRib() const override
+    const LocalRib &getlocalRib() const override
     {
         return BGP::getlocalRib();
     }
@@ -0,0 +1,197 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+// contiguous view of the members of one rank
+template <typename T>
+struct LayerRange
+{
+    const T *first;
+    const T *last;
+
+    const T *begin() const
+    {
+        return first;
+    }
+
+    const T *end() const
+    {
+        return last;
+    }
+
+    size_t size() const
+    {
+        return last - first;
+    }
+
+    bool empty() const
+    {
+        return first == last;
+    }
+
+    const T &operator[](size_t i) const
+    {
+        return first[i];
+    }
+
+    const T &front() const
+    {
+        return *first;
+    }
+
+    const T &back() const
+    {
+        return *(last - 1);
+    }
+
+    vector<T> toVector() const
+    {
+        return vector<T>(first, last);
+    }
+};
+
+template <typename T>
+bool operator==(const LayerRange<T> &range, const vector<T> &values)
+{
+    if (range.size() != values.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (range[i] != values[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool operator==(const vector<T> &values, const LayerRange<T> &range)
+{
+    return range == values;
+}
+
+/*
+Propagation ranks stored back to back in one buffer:
+rank r holds items[offsets[r] .. offsets[r + 1]).
+Iterating yields one LayerRange per rank, lowest rank first.
+ */
+template <typename T>
+class RankLayers
+{
+private:
+    vector<T> items;
+    vector<uint32_t> offsets = {0};
+
+public:
+    class const_iterator
+    {
+    private:
+        const RankLayers *layers;
+        size_t rank;
+
+    public:
+        const_iterator(const RankLayers *layers, size_t rank) : layers(layers), rank(rank) {}
+
+        LayerRange<T> operator*() const
+        {
+            return (*layers)[rank];
+        }
+
+        const_iterator &operator++()
+        {
+            ++rank;
+            return *this;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return rank == other.rank;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return rank != other.rank;
+        }
+    };
+
+    /*
+    Replaces the contents with the given members and rank boundaries.
+    offsets must start at 0, be non-decreasing and end at items.size().
+     */
+    void assign(vector<T> newItems, vector<uint32_t> newOffsets)
+    {
+        items = std::move(newItems);
+        offsets = std::move(newOffsets);
+    }
+
+    void clear()
+    {
+        items.clear();
+        offsets.assign(1, 0);
+    }
+
+    // number of ranks
+    size_t size() const
+    {
+        return offsets.size() - 1;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    LayerRange<T> operator[](size_t rank) const
+    {
+        const T *base = items.data();
+        return {base + offsets[rank], base + offsets[rank + 1]};
+    }
+
+    LayerRange<T> front() const
+    {
+        return (*this)[0];
+    }
+
+    LayerRange<T> back() const
+    {
+        return (*this)[size() - 1];
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size());
+    }
+
+    // every member of every rank, lowest rank first
+    const vector<T> &getItems() const
+    {
+        return items;
+    }
+
+    // rank boundaries into getItems(), size() + 1 entries
+    const vector<uint32_t> &getOffsets() const
+    {
+        return offsets;
+    }
+
+    bool operator==(const RankLayers &other) const
+    {
+        return items == other.items && offsets == other.offsets;
+    }
+
+    bool operator!=(const RankLayers &other) const
+    {
+        return !(*this == other);
+    }
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+#include "Relationships.h"
+#include "PathPool.h"
+
+/*
+Packed 16-byte route record, what RIBs and pending slots store.
+
+    prefixId    interned in PrefixTable::global()
+    path        handle into the PathPool of the RIB's owner (an AsGraph's own)
+    nextHopAsn  the AS that sent the route
+    meta        relationship (2 bits) | rovInvalid (1 bit) | path length (29 bits)
+
+The path length is copied out of the path node, so comparing two routes
+never touches the PathPool. Announcement is the public façade over it.
+
+Route preference is one integer, rankKey(), where smaller is better:
+
+    bits 61-62  3 - relationship (origin 0 ... provider 3)
+    bits 32-60  path length
+    bits  0-31  next-hop ASN
+
+so comparing keys is the relationship, path length, next hop chain of the
+old chooseBest in one branchless compare.
+ */
+class Route
+{
+private:
+    static constexpr uint32_t REL_SHIFT = 30;
+    static constexpr uint32_t ROV_BIT = 1u << 29;
+    static constexpr uint32_t LENGTH_MASK = ROV_BIT - 1;
+
+    uint32_t prefixId = 0;
+    PathHandle path;
+    int32_t nextHopAsn = 0;
+    uint32_t meta = 0;
+
+    // relationships are 1..4, stored as 0..3 so their order is kept
+    static uint32_t packMeta(Relationship relationship, bool rovInvalid, uint32_t length)
+    {
+        return (uint32_t(static_cast<int>(relationship) - 1) << REL_SHIFT) | (rovInvalid ? ROV_BIT : 0) |
+               (length & LENGTH_MASK);
+    }
+
+public:
+    Route() = default;
+
+    // path is a handle into pool, which is only asked for its length
+    Route(uint32_t prefixId, PathHandle path, int nextHopAsn, Relationship relationship, bool rovInvalid,
+          const PathPool &pool)
+        : prefixId(prefixId), path(path), nextHopAsn(nextHopAsn),
+          meta(packMeta(relationship, rovInvalid, pool.length(path))) {}
+
+    uint32_t getPrefixId() const
+    {
+        return prefixId;
+    }
+
+    PathHandle getPath() const
+    {
+        return path;
+    }
+
+    int getNextHopAsn() const
+    {
+        return nextHopAsn;
+    }
+
+    Relationship getRelationship() const
+    {
+        return static_cast<Relationship>((meta >> REL_SHIFT) + 1);
+    }
+
+    bool isRovInvalid() const
+    {
+        return (meta & ROV_BIT) != 0;
+    }
+
+    uint32_t getPathLength() const
+    {
+        return meta & LENGTH_MASK;
+    }
+
+    // the same route as received from nextHopAsn over relationship, path unchanged
+    Route forwarded(int nextHopAsn, Relationship relationship) const
+    {
+        Route r = *this;
+        r.nextHopAsn = nextHopAsn;
+        r.meta = packMeta(relationship, isRovInvalid(), getPathLength());
+        return r;
+    }
+
+    // the same route under another prefix id, e.g. a shard-local one
+    Route withPrefixId(uint32_t id) const
+    {
+        Route r = *this;
+        r.prefixId = id;
+        return r;
+    }
+
+    // one new path node in front of the shared rest of the path, pool is the one path lives in
+    void prependAsn(int asn, PathPool &pool)
+    {
+        path = pool.prepend(asn, path);
+        meta = (meta & ~LENGTH_MASK) | ((getPathLength() + 1) & LENGTH_MASK);
+    }
+
+    // smaller is better, equal keys mean the routes tie on every criterion
+    uint64_t rankKey() const
+    {
+        uint64_t relRank = 3 - (meta >> REL_SHIFT);
+        return (relRank << 61) | (uint64_t(meta & LENGTH_MASK) << 32) | static_cast<uint32_t>(nextHopAsn);
+    }
+
+    /*
+    Returns cand if it is the better route, curr otherwise (also on a tie).
+    Higher relationship first, then the shorter path, then the lower next hop.
+     */
+    static const Route *chooseBest(const Route *curr, const Route *cand)
+    {
+        if (curr == nullptr)
+            return cand;
+        return cand->rankKey() < curr->rankKey() ? cand : curr;
+    }
+
+    /*
+    Index of the best of n routes, the first one on a tie (what folding them
+    in order with chooseBest gives), n if there are none. Uses AVX2 when the
+    CPU has it.
+     */
+    static size_t selectBest(const Route *routes, size_t n);
+};
+
+static_assert(sizeof(Route) == 16, "Route is meant to pack into 16 bytes");
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <memory_resource>
+
+using std::vector, std::mutex, std::atomic, std::unique_ptr;
+
+/*
+Bump allocator for the data of one propagation run (RIB vectors and
+pending announcement slots).
+
+Every thread that allocates gets its own monotonic buffer, so threads never
+contend on a heap lock and allocation is a pointer bump. Deallocation does
+nothing; the memory comes back all at once with reset(), which drops every
+buffer in O(number of threads). Containers using the arena must be gone (or
+emptied without keeping capacity) before reset is called.
+
+The memory is owned by the buffer of the thread that allocated it, but any
+thread may use it afterwards, e.g. a RIB vector grown by one propagation
+thread and read by the next.
+ */
+class RunArena : public std::pmr::memory_resource
+{
+private:
+    // first buffer of every thread, later ones grow geometrically
+    static constexpr size_t INITIAL_BUFFER = 64 * 1024;
+
+    struct ThreadBuffer
+    {
+        std::thread::id owner;
+        unique_ptr<std::pmr::monotonic_buffer_resource> buffer;
+        size_t bytes = 0; // handed out by buffer, only written by its owner
+    };
+
+    mutex lock;                                // guards buffers
+    vector<unique_ptr<ThreadBuffer>> buffers;  // one per thread that allocated since the last reset
+    atomic<uint64_t> generation;               // unique across all arenas, changes on every reset
+
+    // the buffer the calling thread used last, valid while its arena keeps that generation
+    struct CachedBuffer
+    {
+        uint64_t generation = 0;
+        ThreadBuffer *buffer = nullptr;
+    };
+    static thread_local CachedBuffer cached;
+
+    static uint64_t nextGeneration();
+
+    // the calling thread's buffer, created on its first allocation
+    ThreadBuffer &threadBuffer();
+
+protected:
+    void *do_allocate(size_t size, size_t alignment) override;
+
+    void do_deallocate(void *, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+public:
+    RunArena() : generation(nextGeneration()) {}
+
+    RunArena(const RunArena &) = delete;
+    RunArena &operator=(const RunArena &) = delete;
+
+    // releases every buffer, everything allocated from the arena is invalid afterwards
+    void reset();
+
+    // bytes allocated since the last reset, call it while no thread allocates
+    size_t bytesAllocated();
+
+    // threads that allocated since the last reset
+    size_t threadCount();
+};
@@ -0,0 +1,215 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
+
+using std::vector, std::thread, std::mutex, std::atomic, std::condition_variable;
+
+// time one pool participant spent inside parallelFor calls since the last resetStats
+struct ThreadStats
+{
+    double busyMs = 0; // running chunks
+    double idleMs = 0; // the rest of the calls: out of work, at the barrier or not woken
+    size_t chunks = 0; // chunks run, stolen ones included
+};
+
+// one parallelFor call
+struct RoundStats
+{
+    double wallMs = 0;     // on the caller, from dispatch to the end of the barrier
+    double criticalMs = 0; // busy time of the busiest participant
+    double workMs = 0;     // busy time of all participants together
+    double maxChunkMs = 0; // the most expensive chunk, no split of this call could finish faster
+    size_t chunks = 0;
+};
+
+/*
+Persistent workers for the rank-by-rank phases of propagation.
+
+The threads are started once and reused for every parallelFor. The range
+[0, n) is cut into chunks of a fixed size and the chunks are dealt out in
+contiguous runs, one run per participant. The calling thread is a
+participant too, so a pool of size() == 2 has one worker thread.
+
+Scheduling is work stealing. Each participant takes chunks from the front
+of its own run and, once that is empty, steals single chunks from the back
+of the others. A slice holding a few very expensive items (tier-1 inboxes)
+therefore does not hold up the rest of the pool. A run is one atomic word
+(next chunk, end chunk), so popping and stealing are a single CAS each.
+
+Each call ends on a barrier: every worker checks in once per round and the
+caller spins (then yields) until they have, nothing is joined.
+
+Idle workers spin briefly on the round counter before sleeping on a
+condition variable, so back-to-back ranks find them awake while a long
+serial phase does not keep them burning a core. On a single CPU nobody
+spins.
+
+Every chunk is timed. Per participant the pool keeps the time spent
+running chunks (busy) and the rest of the time spent inside parallelFor
+calls (idle: out of work, at the barrier, or not woken), and for the last
+call the busiest participant and the most expensive chunk, which bound
+that call's critical path.
+
+With pinThreads, worker i is pinned to the i-th CPU (modulo the count) of
+the process affinity mask, leaving the first one to the caller. Pinning is
+Linux only, elsewhere it is ignored.
+
+parallelFor is meant to be called from one thread at a time, and the tasks
+must not throw.
+ */
+class ThreadPool
+{
+private:
+    // pause iterations a waiting thread spins before it sleeps or yields
+    static constexpr uint32_t SPIN_LIMIT = 1 << 14;
+
+    using TaskFn = void (*)(const void *task, size_t begin, size_t end);
+
+    // what the current round runs, written before round is advanced
+    struct Job
+    {
+        TaskFn call = nullptr;
+        const void *task = nullptr;
+        size_t count = 0;
+        size_t chunk = 0;              // items per chunk when bounds is nullptr
+        const size_t *bounds = nullptr; // chunk c is [bounds[c], bounds[c + 1]) otherwise
+        size_t parts = 0;
+    };
+
+    /*
+    One participant's run of chunks, (next << 32) | end, and its timings,
+    on its own cache line. Only the participant writes the timings, the
+    caller reads them after the barrier.
+     */
+    struct alignas(64) ChunkRun
+    {
+        atomic<uint64_t> range{0};
+        uint64_t busyNs = 0;
+        uint64_t chunks = 0;
+        uint64_t roundBusyNs = 0;     // this call only
+        uint64_t roundMaxChunkNs = 0; // this call only
+    };
+
+    vector<thread> workers;
+    std::unique_ptr<ChunkRun[]> runs; // one per participant, the caller is 0
+    mutex lock;                 // guards sleeping on wake
+    condition_variable wake;    // signalled when round advances
+    atomic<uint64_t> round{0};  // bumped once per parallelFor and on shutdown
+    atomic<size_t> pending{0};  // workers that have not checked in for the current round
+    Job job;
+    bool stopping = false;      // written before the last round bump
+    size_t pinned = 0;
+    atomic<size_t> steals{0};   // chunks taken from another participant's run
+    uint32_t spinLimit;         // SPIN_LIMIT, or 0 on one CPU where spinning only delays the others
+    bool cpuClock = false;      // time chunks with the thread's CPU clock instead of the wall clock
+    uint64_t wallNs = 0;        // caller's time inside parallelFor since resetStats
+    RoundStats last;
+
+    // now on the clock chunks are timed with
+    uint64_t clockNs() const;
+
+    void workerLoop(size_t worker);
+
+    // first chunk of participant's run, false once it is empty
+    bool popFront(size_t participant, uint32_t &chunk);
+
+    // last chunk of participant's run, false once it is empty
+    bool popBack(size_t participant, uint32_t &chunk);
+
+    void runChunk(size_t participant, uint32_t chunk);
+
+    // runs participant's chunks, then steals until every run is empty
+    void drain(size_t participant);
+
+    // bounds (chunks + 1 entries) overrides the fixed chunk size when it is set
+    void run(size_t count, size_t chunk, const size_t *bounds, size_t chunks, TaskFn call, const void *task);
+
+    // pins each worker to one CPU of the process affinity mask
+    void pinWorkers();
+
+public:
+    /*
+    numThreads participants including the caller (at least 1, so 1 starts
+    no threads and runs everything inline).
+     */
+    explicit ThreadPool(unsigned numThreads = 2, bool pinThreads = false);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // participants in a parallelFor, the caller included
+    size_t size() const
+    {
+        return workers.size() + 1;
+    }
+
+    // workers that were pinned to a CPU
+    size_t pinnedCount() const
+    {
+        return pinned;
+    }
+
+    // chunks stolen since the pool started, to see how uneven the work was
+    size_t stealCount() const
+    {
+        return steals.load(std::memory_order_relaxed);
+    }
+
+    /*
+    Calls fn(begin, end) on disjoint ranges covering [0, count), each at
+    most chunk items, and returns once all of them are done. A range of one
+    chunk or less runs as a single call on the caller, without waking the
+    workers.
+     */
+    template <typename Fn>
+    void parallelFor(size_t count, size_t chunk, const Fn &fn)
+    {
+        chunk = chunk > 0 ? chunk : 1;
+        run(count, chunk, nullptr, (count + chunk - 1) / chunk, [](const void *task, size_t begin, size_t end)
+            { (*static_cast<const Fn *>(task))(begin, end); }, &fn);
+    }
+
+    /*
+    parallelFor over chunks of different sizes: chunk c is [bounds[c],
+    bounds[c + 1]), bounds starts at 0 and increases. Used to give expensive
+    items a chunk of their own.
+     */
+    template <typename Fn>
+    void parallelFor(const vector<size_t> &bounds, const Fn &fn)
+    {
+        if (bounds.size() < 2)
+        {
+            return;
+        }
+        run(bounds.back(), 0, bounds.data(), bounds.size() - 1, [](const void *task, size_t begin, size_t end)
+            { (*static_cast<const Fn *>(task))(begin, end); }, &fn);
+    }
+
+    // per participant, the caller first
+    vector<ThreadStats> stats() const;
+
+    void resetStats();
+
+    // the last parallelFor call
+    const RoundStats &lastRound() const
+    {
+        return last;
+    }
+
+    /*
+    Times chunks with each thread's CPU clock instead of the wall clock, so
+    busy times stay meaningful when the pool has more threads than cores.
+     */
+    void useCpuClock(bool enable)
+    {
+        cpuClock = enable;
+    }
+};
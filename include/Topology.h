@@ -0,0 +1,147 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+#include "AS.h"
+
+using std::vector, std::unordered_map, std::deque;
+
+// contiguous view of one AS's neighbors of a single relationship class
+struct NeighborRange
+{
+    const uint32_t *first;
+    const uint32_t *last;
+
+    const uint32_t *begin() const
+    {
+        return first;
+    }
+
+    const uint32_t *end() const
+    {
+        return last;
+    }
+
+    size_t size() const
+    {
+        return last - first;
+    }
+
+    bool empty() const
+    {
+        return first == last;
+    }
+};
+
+/*
+Compressed sparse row adjacency for one relationship class:
+the neighbors of AS index i are neighbors[offsets[i] .. offsets[i + 1]).
+ */
+struct CsrAdjacency
+{
+    vector<uint32_t> offsets;
+    vector<uint32_t> neighbors;
+
+    NeighborRange operator[](uint32_t index) const
+    {
+        const uint32_t *base = neighbors.data();
+        return {base + offsets[index], base + offsets[index + 1]};
+    }
+
+    size_t memoryBytes() const
+    {
+        return offsets.capacity() * sizeof(uint32_t) + neighbors.capacity() * sizeof(uint32_t);
+    }
+};
+
+/*
+Read-only topology used by the propagation loops.
+
+Every AS gets a dense index 0..N-1 and its providers, customers and peers are
+stored as index lists in three CSR arrays, so a neighbor visit is an array
+read instead of a hash lookup.
+ */
+class Topology
+{
+private:
+    vector<int> asns; // dense index -> ASN
+    CsrAdjacency providers;
+    CsrAdjacency customers;
+    CsrAdjacency peers;
+
+public:
+    /*
+    Builds the CSR arrays from the neighbor vectors of every AS.
+    nodes must be in dense index order, asMap resolves neighbor ASNs to nodes.
+     */
+    void build(const deque<AS> &nodes, const unordered_map<int, AS *> &asMap);
+
+    /*
+    Takes over arrays built elsewhere, e.g. read from a snapshot. They must
+    already be consistent: one ASN per index, every offsets array
+    asns.size() + 1 long and every neighbor a valid index.
+     */
+    void adopt(vector<int> newAsns, CsrAdjacency newProviders, CsrAdjacency newCustomers, CsrAdjacency newPeers)
+    {
+        asns = std::move(newAsns);
+        providers = std::move(newProviders);
+        customers = std::move(newCustomers);
+        peers = std::move(newPeers);
+    }
+
+    size_t size() const
+    {
+        return asns.size();
+    }
+
+    int asnOf(uint32_t idx) const
+    {
+        return asns[idx];
+    }
+
+    NeighborRange getProviders(uint32_t idx) const
+    {
+        return providers[idx];
+    }
+
+    NeighborRange getCustomers(uint32_t idx) const
+    {
+        return customers[idx];
+    }
+
+    NeighborRange getPeers(uint32_t idx) const
+    {
+        return peers[idx];
+    }
+
+    // the arrays themselves, what a snapshot stores
+    const vector<int> &getAsns() const
+    {
+        return asns;
+    }
+
+    const CsrAdjacency &getProviderCsr() const
+    {
+        return providers;
+    }
+
+    const CsrAdjacency &getCustomerCsr() const
+    {
+        return customers;
+    }
+
+    const CsrAdjacency &getPeerCsr() const
+    {
+        return peers;
+    }
+
+    // bytes held by the dense arrays
+    size_t memoryBytes() const
+    {
+        return asns.capacity() * sizeof(int) + providers.memoryBytes() +
+               customers.memoryBytes() + peers.memoryBytes();
+    }
+};
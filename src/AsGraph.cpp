@@ -2,37 +2,150 @@
 #include <fstream>
 #include <string>
 #include <memory>
-#include <thread>
+#include <algorithm>
 
 #include "AsGraph.h"
+#include "CaidaParser.h"
 #include "Utils.h"
 #include "Relationships.h"
 
 using std::cout, std::endl, std::cerr,
-    std::string, std::vector, std::unique_ptr,
-    std::ifstream, std::unordered_set,
-    std::make_unique, std::thread;
+    std::string, std::vector,
+    std::ifstream, std::unordered_set;
 
-bool AsGraph::hasCycle()
+/*
+ASes per work-stealing chunk. Small enough that a few heavy inboxes in one
+rank are spread over the pool, a rank of one chunk runs on the caller.
+ */
+static constexpr size_t RANK_CHUNK = 8;
+
+/*
+Cost model for RankSplit::COST, in units of about one route handled. An AS
+costs the routes waiting in (or about to be pulled into) its inbox plus
+NEIGHBOR_COST per sender it reads or heard from, a step cheaper than
+MIN_PARALLEL_COST in total runs on the caller, and a step is cut into up to
+CHUNKS_PER_THREAD chunks per thread so stealing can still fix a bad
+estimate.
+ */
+static constexpr uint64_t NEIGHBOR_COST = 4;
+static constexpr uint64_t MIN_PARALLEL_COST = 2048;
+static constexpr size_t CHUNKS_PER_THREAD = 4;
+
+vector<uint32_t> AsGraph::walkCustomers(uint32_t src, vector<uint8_t> &state,
+                                        vector<pair<uint32_t, uint32_t>> &stack)
+{
+    if (state[src] != 0)
+    {
+        return {};
+    }
+
+    // each frame is (AS index, position of the next customer to visit)
+    stack.clear();
+    stack.emplace_back(src, 0);
+    state[src] = 1;
+
+    while (!stack.empty())
+    {
+        uint32_t idx = stack.back().first;
+        NeighborRange customers = topology.getCustomers(idx);
+
+        if (stack.back().second < customers.size())
+        {
+            uint32_t customer = customers.first[stack.back().second++];
+            if (state[customer] == 0)
+            {
+                state[customer] = 1;
+                stack.emplace_back(customer, 0);
+            }
+            else if (state[customer] == 1)
+            {
+                // the customer is on the current path, the cycle is the stack from there on
+                vector<uint32_t> found;
+                size_t start = stack.size() - 1;
+                while (stack[start].first != customer)
+                {
+                    --start;
+                }
+                for (size_t i = start; i < stack.size(); ++i)
+                {
+                    found.push_back(stack[i].first);
+                }
+                found.push_back(customer);
+                return found;
+            }
+            continue;
+        }
+
+        state[idx] = 2;
+        stack.pop_back();
+    }
+    return {};
+}
+
+vector<int> AsGraph::findCycle()
 {
-    unordered_set<int> visited;
-    unordered_set<int> safe;
-    for (const auto &pair : adjacencyList)
+    vector<uint8_t> state(topology.size(), 0);
+    vector<pair<uint32_t, uint32_t>> stack;
+    for (uint32_t src = 0; src < topology.size(); ++src)
     {
-        int src = pair.first;
-        if (hasCycle_helper(src, visited, safe))
+        vector<uint32_t> found = walkCustomers(src, state, stack);
+        if (!found.empty())
         {
-            return true;
+            vector<int> asns;
+            for (uint32_t idx : found)
+            {
+                asns.push_back(topology.asnOf(idx));
+            }
+            return asns;
         }
     }
-    return false;
+    return {};
+}
+
+bool AsGraph::hasCycle()
+{
+    return !findCycle().empty();
 }
 
 bool AsGraph::nodeHasCycle(int src)
 {
-    unordered_set<int> visited;
-    unordered_set<int> safe;
-    return hasCycle_helper(src, visited, safe);
+    long idx = indexOf(src);
+    if (idx < 0)
+    {
+        return false;
+    }
+    vector<uint8_t> state(topology.size(), 0);
+    vector<pair<uint32_t, uint32_t>> stack;
+    return !walkCustomers(static_cast<uint32_t>(idx), state, stack).empty();
+}
+
+AS *AsGraph::internAs(int asn)
+{
+    auto [it, inserted] = asMap.try_emplace(asn, nullptr);
+    if (inserted)
+    {
+        // deque keeps node addresses stable as it grows, so asMap can point into it
+        bool useROV = (rovEnabledAsns.find(asn) != rovEnabledAsns.end());
+        it->second = &asNodes.emplace_back(asn, useROV, static_cast<uint32_t>(asNodes.size()), routeResource, &paths);
+    }
+    return it->second;
+}
+
+void AsGraph::buildTopology()
+{
+    topology.build(asNodes, asMap);
+    indexRouters();
+}
+
+void AsGraph::indexRouters()
+{
+    routers.resize(asNodes.size());
+    policyKinds.resize(asNodes.size());
+    for (AS &as : asNodes)
+    {
+        routers[as.getIndex()] = &as.getRouter();
+        policyKinds[as.getIndex()] = as.getPolicyKind();
+    }
 }
 
 int AsGraph::loadROVDeployment(const string &filename)
@@ -58,115 +171,278 @@ int AsGraph::loadROVDeployment(const string &filename)
     return 0;
 }
 
-int AsGraph::buildGraph(const string &fileName)
+int AsGraph::buildGraph(const string &fileName, unsigned numThreads)
 {
-    ifstream input;
-    input.open(fileName);
+    ingestStats = IngestStats();
+    Compression compression = detectCompression(fileName);
+    if (compression == Compression::NONE && numThreads > 1)
+    {
+        return buildGraphParallel(fileName, numThreads);
+    }
+
+    long edges;
+    if (compression != Compression::NONE)
+    {
+        /*
+        .bz2/.gz CAIDA files are decompressed in memory and parsed as they
+        stream in. The edges are only ingested once the stream ended
+        cleanly, a corrupt tail must not leave half a graph behind.
+         */
+        vector<CaidaEdge> buffered;
+        edges = CaidaParser::parseCompressedFile(fileName, compression, [&buffered](int srcAsn, int dstAsn, RelationshipType relType)
+                                                 { buffered.push_back({srcAsn, dstAsn, relType}); });
+        if (edges >= 0)
+        {
+            for (const CaidaEdge &edge : buffered)
+            {
+                ingestEdge(edge.src, edge.dst, edge.relType);
+            }
+        }
+    }
+    else
+    {
+        edges = CaidaParser::parseFile(fileName, [this](int srcAsn, int dstAsn, RelationshipType relType)
+                                       { ingestEdge(srcAsn, dstAsn, relType); });
+    }
 
-    if (input.fail())
+    if (edges < 0)
     {
         cerr << "Error opening the file " << fileName << endl;
+        seenEdges.clear();
         return -1;
     }
+    finishIngest();
+    return 0;
+}
 
-    string line;
-    while (getline(input, line))
+int AsGraph::buildGraphParallel(const string &fileName, unsigned numThreads)
+{
+    /*
+    each thread tokenizes its own slice of the file into a private buffer,
+    then the buffers are merged on this thread in file order.
+
+    replaying in file order gives exactly the same asMap and neighbor
+    vector ordering as the serial path.
+     */
+    MappedFile file;
+    if (!file.open(fileName))
     {
-        if (line.find("#") != string::npos || line.empty())
-        {
-            continue;
-        }
-        vector<string> tokens = Utils::split(line, '|');
-        /*
-        ex line: 51823|198047|0|mlp:
-
-                51823 - src
-                198047 - dst
-                0 - relationship type
-                mlp: - ignore
-        */
-        int srcAsn = stoi(tokens[0]);
-        int dstAsn = stoi(tokens[1]);
-        RelationshipType relType = static_cast<RelationshipType>(stoi(tokens[2]));
-
-        // Create AS nodes for future quick access
-        if (asMap.find(srcAsn) == asMap.end())
-        {
-            bool useROV = (rovEnabledAsns.find(srcAsn) != rovEnabledAsns.end());
-            asMap[srcAsn] = make_unique<AS>(srcAsn, useROV);
-        }
+        cerr << "Error opening the file " << fileName << endl;
+        return -1;
+    }
+
+    vector<vector<CaidaEdge>> buffers = CaidaParser::parseChunks(file.begin(), file.end(), numThreads);
+
+    size_t totalEdges = 0;
+    for (const auto &buffer : buffers)
+    {
+        totalEdges += buffer.size();
+    }
+    // every edge names at most two new ASes, ~1 per edge is a reasonable upper guess
+    asMap.reserve(asMap.size() + totalEdges);
+    seenEdges.reserve(totalEdges);
 
-        if (asMap.find(dstAsn) == asMap.end())
+    for (const auto &buffer : buffers)
+    {
+        for (const CaidaEdge &edge : buffer)
         {
-            bool useROV = (rovEnabledAsns.find(dstAsn) != rovEnabledAsns.end());
-            asMap[dstAsn] = make_unique<AS>(dstAsn, useROV);
+            ingestEdge(edge.src, edge.dst, edge.relType);
         }
+    }
+    finishIngest();
+    return 0;
+}
+
+void AsGraph::addEdge(int srcAsn, int dstAsn, RelationshipType relType)
+{
+    // Create AS nodes for future quick access
+    AS *srcAs = internAs(srcAsn);
+    AS *dstAs = internAs(dstAsn);
+
+    if (relType == RelationshipType::PEER_TO_PEER)
+    {
+        // 0 = peer-to-peer (bidirectional)
+        srcAs->addPeer(dstAsn);
+        dstAs->addPeer(srcAsn);
+    }
+    else if (relType == RelationshipType::PROVIDER_TO_CUSTOMER)
+    {
+        // provider-to-customer
+        srcAs->addCustomer(dstAsn);
+        dstAs->addProvider(srcAsn);
+    }
+}
+
+void AsGraph::ingestEdge(int srcAsn, int dstAsn, RelationshipType relType)
+{
+    ++ingestStats.lines;
+
+    // one entry per unordered pair, so b|a is found when a|b was read first
+    uint32_t lo = static_cast<uint32_t>(std::min(srcAsn, dstAsn));
+    uint32_t hi = static_cast<uint32_t>(std::max(srcAsn, dstAsn));
+    auto [it, inserted] = seenEdges.try_emplace((uint64_t(lo) << 32) | hi, SeenEdge{srcAsn, relType, false});
+    if (inserted)
+    {
+        addEdge(srcAsn, dstAsn, relType);
+        return;
+    }
+
+    SeenEdge &seen = it->second;
+    bool sameDirection = seen.srcAsn == srcAsn || relType == RelationshipType::PEER_TO_PEER;
+    if (!seen.dropped && seen.relType == relType && sameDirection)
+    {
+        ++ingestStats.duplicates;
+        return;
+    }
 
-        // we use emplace to directly create the pair in the vector
-        adjacencyList[srcAsn].emplace_back(dstAsn, relType);
+    ++ingestStats.conflicts;
+    if (seen.dropped || conflictRule == ConflictRule::KEEP_FIRST)
+    {
+        return;
+    }
+
+    removeEdge(seen.srcAsn, seen.srcAsn == srcAsn ? dstAsn : srcAsn, seen.relType);
+    if (conflictRule == ConflictRule::KEEP_LAST)
+    {
+        addEdge(srcAsn, dstAsn, relType);
+        seen.srcAsn = srcAsn;
+        seen.relType = relType;
+    }
+    else
+    {
+        seen.dropped = true;
+    }
+}
+
+void AsGraph::finishIngest()
+{
+    // incremental updates look edges up in the neighbor vectors, the pair index is only needed while reading
+    seenEdges.clear();
+    seenEdges.rehash(0);
+    buildTopology();
+}
 
-        if (relType == RelationshipType::PEER_TO_PEER)
+unordered_map<int, vector<pair<int, RelationshipType>>> AsGraph::getAdjacencyList() const
+{
+    unordered_map<int, vector<pair<int, RelationshipType>>> adjacency;
+    for (uint32_t idx = 0; idx < topology.size(); ++idx)
+    {
+        NeighborRange customers = topology.getCustomers(idx);
+        NeighborRange peers = topology.getPeers(idx);
+        if (customers.empty() && peers.empty())
+        {
+            continue;
+        }
+        auto &list = adjacency[topology.asnOf(idx)];
+        list.reserve(customers.size() + peers.size());
+        for (uint32_t cIdx : customers)
         {
-            // 0 = peer-to-peer (bidirectional)
-            adjacencyList[dstAsn].emplace_back(srcAsn, relType);
-            asMap[srcAsn]->addPeer(dstAsn);
-            asMap[dstAsn]->addPeer(srcAsn);
+            list.emplace_back(topology.asnOf(cIdx), RelationshipType::PROVIDER_TO_CUSTOMER);
         }
-        else if (relType == RelationshipType::PROVIDER_TO_CUSTOMER)
+        for (uint32_t pIdx : peers)
         {
-            // provider-to-customer
-            asMap[srcAsn]->addCustomer(dstAsn);
-            asMap[dstAsn]->addProvider(srcAsn);
+            list.emplace_back(topology.asnOf(pIdx), RelationshipType::PEER_TO_PEER);
         }
     }
-    return 0;
+    return adjacency;
 }
 
-void AsGraph::flattenGraph()
+bool AsGraph::flattenGraph()
 {
-    unordered_map<int, int> rankMap;
-    vector<int> ranks;
-    for (const auto &pair : asMap)
+    /*
+    Kahn-style countdown over provider->customer edges: pending[idx] is the
+    number of customers not ranked yet. Stubs start ranked at 0, and a
+    provider is queued the moment its last customer is ranked, so its rank
+    (1 + highest customer rank) is final when it is popped.
+     */
+    cycle.clear();
+    const uint32_t n = static_cast<uint32_t>(topology.size());
+    vector<uint32_t> pending(n);
+    vector<uint32_t> queue;
+    queue.reserve(n);
+    rankOf.assign(n, 0);
+
+    for (uint32_t idx = 0; idx < n; ++idx)
     {
-        int asId = pair.first;
-        AS *as = pair.second.get();
-        if (as->getCustomers().empty())
+        pending[idx] = static_cast<uint32_t>(topology.getCustomers(idx).size());
+        if (pending[idx] == 0)
         {
-            rankMap[asId] = 0;
-            ranks.push_back(asId);
+            queue.push_back(idx);
         }
-        else
+    }
+
+    uint32_t rankCount = n > 0 ? 1 : 0;
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        uint32_t cIdx = queue[head];
+        uint32_t providerRank = rankOf[cIdx] + 1;
+        for (uint32_t pIdx : topology.getProviders(cIdx))
         {
-            rankMap[asId] = -1;
+            rankOf[pIdx] = std::max(rankOf[pIdx], providerRank);
+            if (--pending[pIdx] == 0)
+            {
+                queue.push_back(pIdx);
+                rankCount = std::max(rankCount, providerRank + 1);
+            }
         }
     }
 
-    int rankSize = 1;
-    for (size_t i = 0; i < ranks.size(); ++i)
+    if (queue.size() < n)
     {
-        int asn = ranks[i];
-        AS *as = asMap[asn].get();
-
-        int newRank = rankMap[asn] + 1;
-        rankSize = std::max(rankSize, newRank);
-        for (int pAsn : as->getProviders())
+        /*
+        every AS left over still waits on a customer that is also left over,
+        so a DFS from any of them restricted to the left over ASes hits a cycle
+         */
+        vector<uint8_t> state(n, 2);
+        uint32_t start = n;
+        for (uint32_t idx = 0; idx < n; ++idx)
         {
-            if (newRank > rankMap[pAsn])
+            if (pending[idx] > 0)
             {
-                rankMap[pAsn] = newRank;
-                ranks.push_back(pAsn);
+                state[idx] = 0;
+                start = std::min(start, idx);
             }
         }
+        vector<pair<uint32_t, uint32_t>> stack;
+        for (uint32_t idx : walkCustomers(start, state, stack))
+        {
+            cycle.push_back(topology.asnOf(idx));
+        }
+        rankOf.clear();
+        flattenedGraph.clear();
+        rankIndices.clear();
+        return false;
+    }
+
+    layoutRanks(rankCount);
+    return true;
+}
+
+void AsGraph::layoutRanks(uint32_t rankCount)
+{
+    // counting sort by rank, members of a rank stay in dense index order
+    vector<uint32_t> offsets(rankCount + 1, 0);
+    for (uint32_t rank : rankOf)
+    {
+        ++offsets[rank + 1];
+    }
+    for (uint32_t r = 0; r < rankCount; ++r)
+    {
+        offsets[r + 1] += offsets[r];
     }
 
-    // create flattened graph (allocate space for easy insertion)
-    flattenedGraph.resize(rankSize);
-    for (const auto &pair : rankMap)
+    vector<uint32_t> indices(rankOf.size());
+    vector<int> asns(rankOf.size());
+    vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (uint32_t idx = 0; idx < rankOf.size(); ++idx)
     {
-        int asn = pair.first;
-        int rank = pair.second;
-        flattenedGraph[rank].push_back(asn);
+        uint32_t pos = next[rankOf[idx]]++;
+        indices[pos] = idx;
+        asns[pos] = topology.asnOf(idx);
     }
+
+    rankIndices.assign(std::move(indices), offsets);
+    flattenedGraph.assign(std::move(asns), std::move(offsets));
 }
 
 void AsGraph::processInitialAnnouncements(const string &filename)
@@ -179,7 +455,8 @@ void AsGraph::processInitialAnnouncements(const string &filename)
     }
 
     string line;
-    vector<int> seededAsns;
+    vector<Announcement> seeds;
+    PrefixTable &prefixTable = PrefixTable::global();
 
     // skip header line
     getline(file, line);
@@ -188,9 +465,15 @@ void AsGraph::processInitialAnnouncements(const string &filename)
     {
         vector<string> res = Utils::split(line, ',');
 
+        if (res.size() < 2)
+        {
+            continue;
+        }
+
         int asn = stoi(res[0]);
         string prefix = res[1];
-        string rovStr = res[2];
+        // the rov_invalid column is optional, a missing value means valid
+        string rovStr = res.size() > 2 ? res[2] : "";
         if (!rovStr.empty() && rovStr.back() == '\r')
         {
             rovStr.pop_back();
@@ -202,168 +485,597 @@ void AsGraph::processInitialAnnouncements(const string &filename)
             cerr << "ASN: " << asn << " not found." << endl;
             continue;
         }
-        AS *as = asMap[asn].get();
-        Announcement a(prefix, {asn}, asn, Relationship::ORIGIN, rovInvalid);
+        // the only place prefixes are interned, propagation copies the ids
+        Route origin(prefixTable.intern(prefix), paths.prepend(asn, PathHandle()), asn, Relationship::ORIGIN, rovInvalid, paths);
+        seeds.push_back(Announcement(origin, paths));
+    }
+    file.close();
+
+    chooseRibLayout(seeds);
 
-        Policy &policy = as->getPolicy();
+    for (const Announcement &a : seeds)
+    {
+        Policy &policy = asMap[a.getNextHopAsn()]->getPolicy();
         policy.addOrigin(a);
+        seededIds.push_back(a.getPrefixId());
     }
-    file.close();
+    std::sort(seededIds.begin(), seededIds.end());
+    seededIds.erase(std::unique(seededIds.begin(), seededIds.end()), seededIds.end());
 }
 
-void processAnnouncementRange(const vector<int> &asns, size_t start, size_t end,
-                              unordered_map<int, unique_ptr<AS>> &asMap)
+void AsGraph::clearRoutes()
 {
-    /*
-    This is the helper function each thread uses to process their half of the work.
-
-    It takes as arguments the list of rank ASNs, the start and end indices for their work
-    and and asMap for accessing the AS references.
-     */
-    for (size_t i = start; i < end; ++i)
+    // nothing may point into the arena once it is reset
+    for (AS &as : asNodes)
     {
-        int asn = asns[i];
-        AS *as = asMap[asn].get();
-        as->getPolicy().processAnnouncements();
+        as.getPolicy().clearRoutes();
     }
+    denseRib.reset(0, 0);
+    seededLayout = RibLayout::SPARSE;
+    seededIds.clear();
+    arena.reset();
+    paths.reset();
+    rankStats.clear();
 }
 
-void AsGraph::propagateUp()
+void AsGraph::chooseRibLayout(const vector<Announcement> &seeds)
 {
     /*
-    for all ASNs in rank 0
+    Dense rows are only set up once, a later seeding keeps whatever the RIBs
+    already use (ids past the row width land in the sparse part).
+     */
+    if (seeds.empty() || denseRib.getWidth() != 0 || ribLayout == RibLayout::SPARSE)
+    {
+        return;
+    }
 
-    - iterate through their providers (if any)
-    - send announcements to their providers
+    uint32_t width = 0;
+    for (const Announcement &a : seeds)
+    {
+        width = std::max(width, a.getPrefixId() + 1);
+    }
 
-    we do this for each rank iteratively
-    */
-    for (size_t currRank = 0; currRank < flattenedGraph.size(); ++currRank)
+    RibLayout layout = ribLayout;
+    if (layout == RibLayout::AUTO)
     {
-        for (int cAsn : flattenedGraph[currRank])
+        /*
+        A prefix with a valid origin can reach every AS, one with only
+        invalid origins is expected to reach the ASes that do not run ROV.
+         */
+        vector<uint8_t> reach(width, 0); // 0 = not seeded, 1 = invalid origins only, 2 = a valid origin
+        for (const Announcement &a : seeds)
+        {
+            reach[a.getPrefixId()] = std::max<uint8_t>(reach[a.getPrefixId()], a.isRovInvalid() ? 1 : 2);
+        }
+        double bgpShare = asNodes.empty() ? 0.0 : 1.0 - double(rovEnabledAsns.size()) / asNodes.size();
+        double expectedRoutes = 0;
+        for (uint8_t r : reach)
         {
-            AS *as = asMap[cAsn].get();
-            Policy &policy = as->getPolicy();
-            const auto &rib = policy.getlocalRib();
+            expectedRoutes += r == 2 ? 1.0 : (r == 1 ? bgpShare : 0.0);
+        }
+        layout = DenseRibStore::chooseLayout(asNodes.size(), width, expectedRoutes);
+    }
 
-            // send original nodes announcements to providers
-            for (int pAsn : as->getProviders())
+    if (layout != RibLayout::DENSE)
+    {
+        return;
+    }
+
+    denseRib.reset(asNodes.size(), width);
+    for (AS &as : asNodes)
+    {
+        as.getPolicy().useDenseRib(denseRib.row(as.getIndex()), denseRib.presentRow(as.getIndex()), width);
+    }
+    seededLayout = RibLayout::DENSE;
+}
+
+ThreadPool &AsGraph::threadPool()
+{
+    if (pool == nullptr)
+    {
+        ownPool = std::make_unique<ThreadPool>(numThreads);
+        pool = ownPool.get();
+    }
+    return *pool;
+}
+
+template <typename CostFn, typename WorkFn>
+void AsGraph::runBalanced(PropagationPhase phase, size_t rank, size_t count, const CostFn &cost, const WorkFn &work)
+{
+    ThreadPool &workers = threadPool();
+    if (rankSplit == RankSplit::UNIFORM)
+    {
+        workers.parallelFor(count, RANK_CHUNK, work);
+        rankStats.push_back({phase, rank, count, 0, workers.lastRound()});
+        return;
+    }
+
+    // nothing to cut, skip the cost scan
+    if (workers.size() == 1 || count < 2)
+    {
+        chunkBounds.assign({0, count});
+        workers.parallelFor(chunkBounds, work);
+        rankStats.push_back({phase, rank, count, 0, workers.lastRound()});
+        return;
+    }
+
+    costPrefix.resize(count + 1);
+    costPrefix[0] = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        costPrefix[i + 1] = costPrefix[i] + cost(i);
+    }
+    uint64_t total = costPrefix[count];
+
+    chunkBounds.assign(1, 0);
+    size_t pieces = std::min(count, workers.size() * CHUNKS_PER_THREAD);
+    if (total >= MIN_PARALLEL_COST)
+    {
+        /*
+        Cut k goes where the prefix sum is closest to k/pieces of the total.
+        An AS heavier than a share pulls the cuts on both sides onto itself,
+        so it ends up alone in its chunk; cuts that land on the same AS
+        collapse into one.
+         */
+        for (size_t k = 1; k < pieces; ++k)
+        {
+            uint64_t target = total * k / pieces;
+            size_t cut = std::lower_bound(costPrefix.begin(), costPrefix.end(), target) - costPrefix.begin();
+            if (cut > 0 && target - costPrefix[cut - 1] < costPrefix[cut] - target)
+            {
+                --cut;
+            }
+            if (cut > chunkBounds.back() && cut < count)
             {
-                AS *providerAs = asMap[pAsn].get();
+                chunkBounds.push_back(cut);
+            }
+        }
+    }
+    chunkBounds.push_back(count);
 
-                for (const auto &ann : rib)
-                {
-                    const Announcement &currAnn = ann.second;
+    workers.parallelFor(chunkBounds, work);
+    rankStats.push_back({phase, rank, count, total, workers.lastRound()});
+}
 
-                    // Reuse announcement object, only change relationship and nextHop
-                    providerAs->getPolicy().enqueueAnnouncement(
-                        Announcement(currAnn.getPrefix(), currAnn.getAsPath(),
-                                     cAsn, Relationship::CUSTOMER, currAnn.isRovInvalid()));
-                }
+// what processAnnouncements for one AS costs, see NEIGHBOR_COST
+static uint64_t processCost(const BGP &router, NeighborRange senders)
+{
+    return router.pendingCount() + 1 + NEIGHBOR_COST * senders.size();
+}
+
+void AsGraph::processRank(PropagationPhase phase, size_t rank)
+{
+    /*
+    The rank is cut into chunks of about equal inbox length that the pool
+    threads take (and steal) to process those inboxes. ASes of one rank
+    never send to each other here, so the chunks touch disjoint RIBs.
+    ROV processes exactly like BGP, so the call is not virtual.
+     */
+    LayerRange<uint32_t> indices = rankIndices[rank];
+    // going up the inboxes were filled by customers, going down by providers
+    bool up = phase == PropagationPhase::UP;
+    runBalanced(
+        phase, rank, indices.size(), [&](size_t i)
+        {
+            uint32_t idx = indices[i];
+            return processCost(*routers[idx], up ? topology.getCustomers(idx) : topology.getProviders(idx));
+        },
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                routers[indices[i]]->BGP::processAnnouncements();
             }
+        });
+}
+
+/*
+Sends every route in rib to receiver as coming from fromAsn over rel.
+Instantiated per receiving policy: ROV would discard invalid routes on
+arrival, so they are never forwarded to it, and the inbox call is the
+inlined BGP one for both.
+ */
+template <PolicyKind Kind>
+static void sendRoutes(const LocalRib &rib, BGP &receiver, int fromAsn, Relationship rel)
+{
+    rib.forEachRoute([&](const Route &currRoute)
+                     {
+        if constexpr (Kind == PolicyKind::ROV)
+        {
+            if (currRoute.isRovInvalid())
+                return;
         }
+        // same prefix and path, only the relationship and nextHop change
+        receiver.BGP::enqueueRoute(currRoute.forwarded(fromAsn, rel)); });
+}
+
+// picks the sendRoutes instantiation for the receiver's policy
+static void sendRoutes(PolicyKind kind, const LocalRib &rib, BGP &receiver, int fromAsn, Relationship rel)
+{
+    switch (kind)
+    {
+    case PolicyKind::ROV:
+        sendRoutes<PolicyKind::ROV>(rib, receiver, fromAsn, rel);
+        break;
+    case PolicyKind::BGP:
+        sendRoutes<PolicyKind::BGP>(rib, receiver, fromAsn, rel);
+        break;
+    }
+}
 
-        // before moving, process next rank's announcements with 2 threads
-        if (currRank + 1 < flattenedGraph.size())
+/*
+Receivers with at least this many senders and a dense RIB pick the best
+candidate of every dense prefix id with one Route::selectBest over the
+senders' slots, so only the winner reaches the inbox. With fewer senders
+the routes are streamed into the inbox one by one.
+ */
+static constexpr size_t BATCH_MIN_SENDERS = 8;
+
+/*
+pullRoutes for a receiver with a dense row of width slots. Candidates are
+gathered in sender order, so selectBest's first best on a tie is the one
+the one-by-one fold would keep. Ids past the row are streamed.
+ */
+template <PolicyKind Kind>
+static void pullBatched(const Topology &topology, const vector<BGP *> &routers, BGP &receiver,
+                        NeighborRange senders, Relationship rel, uint32_t width)
+{
+    thread_local vector<const LocalRib *> ribs;
+    thread_local vector<Route> candidates;
+    ribs.clear();
+    for (uint32_t senderIdx : senders)
+    {
+        ribs.push_back(&routers[senderIdx]->BGP::getlocalRib());
+    }
+
+    for (uint32_t id = 0; id < width; ++id)
+    {
+        candidates.clear();
+        for (size_t s = 0; s < ribs.size(); ++s)
+        {
+            const Route *r = ribs[s]->findId(id);
+            if (r == nullptr)
+                continue;
+            if constexpr (Kind == PolicyKind::ROV)
+            {
+                if (r->isRovInvalid())
+                    continue;
+            }
+            candidates.push_back(r->forwarded(topology.asnOf(senders.first[s]), rel));
+        }
+        if (!candidates.empty())
         {
-            const vector<int> &nextRank = flattenedGraph[currRank + 1];
-            size_t midpoint = nextRank.size() / 2;
+            receiver.BGP::enqueueRoute(candidates[Route::selectBest(candidates.data(), candidates.size())]);
+        }
+    }
 
-            thread t1(processAnnouncementRange, std::cref(nextRank), 0, midpoint, std::ref(asMap));
-            thread t2(processAnnouncementRange, std::cref(nextRank), midpoint, nextRank.size(), std::ref(asMap));
+    for (size_t s = 0; s < ribs.size(); ++s)
+    {
+        int fromAsn = topology.asnOf(senders.first[s]);
+        ribs[s]->forEachRouteFrom(width, [&](const Route &currRoute)
+                                  {
+            if constexpr (Kind == PolicyKind::ROV)
+            {
+                if (currRoute.isRovInvalid())
+                    return;
+            }
+            receiver.BGP::enqueueRoute(currRoute.forwarded(fromAsn, rel)); });
+    }
+}
 
-            t1.join();
-            t2.join();
+/*
+Enqueues every route of the senders' RIBs into routers[idx], as received
+over rel. Only idx's inbox is written, the senders' RIBs are read.
+ */
+static void pullRoutes(const Topology &topology, const vector<BGP *> &routers, PolicyKind kind,
+                       uint32_t idx, NeighborRange senders, Relationship rel)
+{
+    BGP &receiver = *routers[idx];
+    uint32_t width = receiver.BGP::getlocalRib().getDenseWidth();
+    if (width > 0 && senders.size() >= BATCH_MIN_SENDERS)
+    {
+        if (kind == PolicyKind::ROV)
+        {
+            pullBatched<PolicyKind::ROV>(topology, routers, receiver, senders, rel, width);
+        }
+        else
+        {
+            pullBatched<PolicyKind::BGP>(topology, routers, receiver, senders, rel, width);
         }
+        return;
+    }
+
+    for (uint32_t senderIdx : senders)
+    {
+        sendRoutes(kind, routers[senderIdx]->BGP::getlocalRib(), receiver, topology.asnOf(senderIdx), rel);
     }
 }
 
-void AsGraph::propagateAcross()
+// what pullRoutes into one AS costs, see NEIGHBOR_COST
+static uint64_t pullCost(const vector<BGP *> &routers, NeighborRange senders)
+{
+    uint64_t cost = 1;
+    for (uint32_t senderIdx : senders)
+    {
+        cost += routers[senderIdx]->BGP::getlocalRib().size() + NEIGHBOR_COST;
+    }
+    return cost;
+}
+
+void AsGraph::propagateUp()
 {
     /*
-    for all ASNs in our graph, we send their announcements to their peers
+    for all ASes in rank 0
+
+    - iterate through their providers (if any)
+    - send announcements to their providers
+
+    we do this for each rank iteratively
     */
-    for (const auto &pair : asMap)
+    // a propagation starts here, only its steps are kept
+    rankStats.clear();
+    if (engine == PropagationEngine::PULL)
+    {
+        pullUp();
+        return;
+    }
+
+    for (size_t currRank = 0; currRank < rankIndices.size(); ++currRank)
     {
-        AS *as = pair.second.get();
-        const Policy &policy = as->getPolicy();
-        const auto &rib = policy.getlocalRib();
-        for (int peerAsn : as->getPeers())
+        for (uint32_t cIdx : rankIndices[currRank])
         {
-            AS *peerAs = asMap[peerAsn].get();
+            int cAsn = topology.asnOf(cIdx);
+            const auto &rib = routers[cIdx]->BGP::getlocalRib();
 
-            for (const auto &p : rib)
+            // send original nodes announcements to providers
+            for (uint32_t pIdx : topology.getProviders(cIdx))
             {
-                const Announcement &currAnn = p.second;
-
-                peerAs->getPolicy().enqueueAnnouncement(
-                    Announcement(currAnn.getPrefix(), currAnn.getAsPath(),
-                                 as->getAsn(), Relationship::PEER, currAnn.isRovInvalid()));
+                sendRoutes(policyKinds[pIdx], rib, *routers[pIdx], cAsn, Relationship::CUSTOMER);
             }
         }
-    }
 
-    // after all enqueuing, process all announcements with 2 threads
-    vector<int> allAsns;
-    allAsns.reserve(asMap.size());
-    for (const auto &pair : asMap)
-    {
-        allAsns.push_back(pair.first);
+        // before moving, process next rank's announcements on the pool
+        if (currRank + 1 < rankIndices.size())
+        {
+            processRank(PropagationPhase::UP, currRank + 1);
+        }
     }
+}
 
-    size_t midpoint = allAsns.size() / 2;
-    thread t1(processAnnouncementRange, std::cref(allAsns), 0, midpoint, std::ref(asMap));
-    thread t2(processAnnouncementRange, std::cref(allAsns), midpoint, allAsns.size(), std::ref(asMap));
+void AsGraph::propagateAcross()
+{
+    /*
+    for all ASes in our graph, we send their announcements to their peers
 
-    t1.join();
-    t2.join();
+    Both engines exchange peer routes by pulling: every AS reads its peers'
+    RIBs into its own inbox on the pool, so nothing is shared between
+    threads. Peers can be in any rank, so only after the barrier does anyone
+    process (a RIB must not change while a peer reads it).
+    */
+    runBalanced(
+        PropagationPhase::ACROSS, 0, routers.size(), [this](size_t idx)
+        { return pullCost(routers, topology.getPeers(idx)); },
+        [this](size_t begin, size_t end)
+        {
+            for (size_t idx = begin; idx < end; ++idx)
+            {
+                pullRoutes(topology, routers, policyKinds[idx], idx, topology.getPeers(idx), Relationship::PEER);
+            }
+        });
+    runBalanced(
+        PropagationPhase::ACROSS, 0, routers.size(), [this](size_t idx)
+        { return processCost(*routers[idx], topology.getPeers(idx)); },
+        [this](size_t begin, size_t end)
+        {
+            for (size_t idx = begin; idx < end; ++idx)
+            {
+                routers[idx]->BGP::processAnnouncements();
+            }
+        });
 }
 
 void AsGraph::propagateDown()
 {
     /*
-    for all ASNs in rank i
+    for all ASes in rank i
 
     - iterate through their customers (if any)
     - send announcements to their customers
 
     we do this for each rank iteratively, going from top to bottom
     */
-    for (int currRank = flattenedGraph.size() - 1; currRank >= 0; --currRank)
+    if (engine == PropagationEngine::PULL)
     {
+        pullDown();
+        return;
+    }
 
-        // process announcements for current rank first
-        const vector<int> &currRankAsns = flattenedGraph[currRank];
-        size_t midpoint = currRankAsns.size() / 2;
-
-        thread t1(processAnnouncementRange, std::cref(currRankAsns), 0, midpoint, std::ref(asMap));
-        thread t2(processAnnouncementRange, std::cref(currRankAsns), midpoint, currRankAsns.size(), std::ref(asMap));
+    for (int currRank = rankIndices.size() - 1; currRank >= 0; --currRank)
+    {
 
-        t1.join();
-        t2.join();
+        // process announcements for current rank first
+        LayerRange<uint32_t> currRankIndices = rankIndices[currRank];
+        processRank(PropagationPhase::DOWN, currRank);
 
         // Then, send announcements from current rank to their customers
-        for (int asn : flattenedGraph[currRank])
+        for (uint32_t idx : currRankIndices)
         {
             // gather information from original node
-            AS *as = asMap[asn].get();
-            Policy &policy = as->getPolicy();
-            const auto &rib = policy.getlocalRib();
+            int asn = topology.asnOf(idx);
+            const auto &rib = routers[idx]->BGP::getlocalRib();
 
             // send original nodes announcements to customers
-            for (int cAsn : as->getCustomers())
+            for (uint32_t cIdx : topology.getCustomers(idx))
             {
-                AS *customerAs = asMap[cAsn].get();
+                sendRoutes(policyKinds[cIdx], rib, *routers[cIdx], asn, Relationship::PROVIDER);
+            }
+        }
+    }
+}
 
-                for (const auto &p : rib)
+void AsGraph::pullUp()
+{
+    /*
+    Customers always sit in lower ranks, so when rank r is reached every
+    customer RIB is final for this phase. Each AS of the rank pulls from its
+    customers and processes right away, the whole rank on the pool.
+    Rank 0 has no customers.
+     */
+    for (size_t currRank = 1; currRank < rankIndices.size(); ++currRank)
+    {
+        LayerRange<uint32_t> indices = rankIndices[currRank];
+        runBalanced(
+            PropagationPhase::UP, currRank, indices.size(), [&](size_t i)
+            { return pullCost(routers, topology.getCustomers(indices[i])); },
+            [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
                 {
-                    const Announcement &currAnn = p.second;
+                    uint32_t idx = indices[i];
+                    pullRoutes(topology, routers, policyKinds[idx], idx, topology.getCustomers(idx), Relationship::CUSTOMER);
+                    routers[idx]->BGP::processAnnouncements();
+                }
+            });
+    }
+}
 
-                    customerAs->getPolicy().enqueueAnnouncement(
-                        Announcement(currAnn.getPrefix(), currAnn.getAsPath(),
-                                     asn, Relationship::PROVIDER, currAnn.isRovInvalid()));
+void AsGraph::pullDown()
+{
+    // providers always sit in higher ranks, so they are final when rank r pulls
+    for (size_t currRank = rankIndices.size(); currRank-- > 0;)
+    {
+        LayerRange<uint32_t> indices = rankIndices[currRank];
+        runBalanced(
+            PropagationPhase::DOWN, currRank, indices.size(), [&](size_t i)
+            { return pullCost(routers, topology.getProviders(indices[i])); },
+            [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    uint32_t idx = indices[i];
+                    pullRoutes(topology, routers, policyKinds[idx], idx, topology.getProviders(idx), Relationship::PROVIDER);
+                    routers[idx]->BGP::processAnnouncements();
                 }
-            }
+            });
+    }
+}
+
+void AsGraph::propagateShard(size_t first, size_t last, ShardRoutes &out)
+{
+    /*
+    The shard's routes use local prefix ids, the position of the id among
+    the shard's seeded ids, so each state's pending slots only span the
+    shard however far apart its ids are. Everything but the paths is
+    allocated from a private arena released when the shard is done; the
+    paths go to the graph's pool, which the merged routes keep using.
+     */
+    RunArena shardArena;
+    deque<BGP> states;
+    vector<BGP *> shardRouters;
+    shardRouters.reserve(routers.size());
+    for (uint32_t idx = 0; idx < routers.size(); ++idx)
+    {
+        states.emplace_back(topology.asnOf(idx), &shardArena, &paths);
+        shardRouters.push_back(&states.back());
+    }
+
+    // dense RIBs stay dense for the shard, with rows only as wide as the shard
+    DenseRibStore shardRows;
+    if (seededLayout == RibLayout::DENSE)
+    {
+        uint32_t width = static_cast<uint32_t>(last - first);
+        shardRows.reset(routers.size(), width);
+        for (uint32_t idx = 0; idx < routers.size(); ++idx)
+        {
+            shardRouters[idx]->useDenseRib(shardRows.row(idx), shardRows.presentRow(idx), width);
+        }
+    }
+
+    // before propagation the RIBs hold the origins (ROV ones already filtered)
+    auto shardBegin = seededIds.begin() + first;
+    auto shardEnd = seededIds.begin() + last;
+    for (uint32_t idx = 0; idx < routers.size(); ++idx)
+    {
+        routers[idx]->BGP::getlocalRib().forEachRoute([&](const Route &origin)
+                                                     {
+            auto it = std::lower_bound(shardBegin, shardEnd, origin.getPrefixId());
+            if (it != shardEnd && *it == origin.getPrefixId())
+            {
+                shardRouters[idx]->adoptRoute(origin.withPrefixId(static_cast<uint32_t>(it - shardBegin)));
+            } });
+    }
+
+    // the pull engine's phases, serially: customers and providers are final when a rank pulls
+    for (size_t currRank = 1; currRank < rankIndices.size(); ++currRank)
+    {
+        for (uint32_t idx : rankIndices[currRank])
+        {
+            pullRoutes(topology, shardRouters, policyKinds[idx], idx, topology.getCustomers(idx), Relationship::CUSTOMER);
+            shardRouters[idx]->BGP::processAnnouncements();
+        }
+    }
+    for (uint32_t idx = 0; idx < shardRouters.size(); ++idx)
+    {
+        pullRoutes(topology, shardRouters, policyKinds[idx], idx, topology.getPeers(idx), Relationship::PEER);
+    }
+    for (BGP *state : shardRouters)
+    {
+        state->BGP::processAnnouncements();
+    }
+    for (size_t currRank = rankIndices.size(); currRank-- > 0;)
+    {
+        for (uint32_t idx : rankIndices[currRank])
+        {
+            pullRoutes(topology, shardRouters, policyKinds[idx], idx, topology.getProviders(idx), Relationship::PROVIDER);
+            shardRouters[idx]->BGP::processAnnouncements();
         }
     }
+
+    out.offsets.assign(1, 0);
+    out.offsets.reserve(shardRouters.size() + 1);
+    for (BGP *state : shardRouters)
+    {
+        state->BGP::getlocalRib().forEachRoute([&](const Route &r)
+                                               { out.routes.push_back(r.withPrefixId(shardBegin[r.getPrefixId()])); });
+        out.offsets.push_back(static_cast<uint32_t>(out.routes.size()));
+    }
+}
+
+void AsGraph::propagateByPrefix(size_t shards)
+{
+    ThreadPool &workers = threadPool();
+    /*
+    The table is shared by every graph, only ids this graph seeded can have
+    routes. Cutting the sorted seeded ids by position gives every shard the
+    same number of live prefixes however the ids are spread.
+     */
+    size_t count = seededIds.size();
+    if (shards == 0)
+    {
+        shards = workers.size() * 4;
+    }
+    shards = std::max<size_t>(1, std::min(shards, count));
+
+    // one shard per parallelFor item, the pool's work stealing evens out unequal shards
+    vector<ShardRoutes> results(shards);
+    workers.parallelFor(shards, 1, [&](size_t begin, size_t end)
+                        {
+        for (size_t s = begin; s < end; ++s)
+        {
+            propagateShard(count * s / shards, count * (s + 1) / shards, results[s]);
+        } });
+
+    // merge: every AS takes its routes from each shard, in prefix id order
+    workers.parallelFor(routers.size(), RANK_CHUNK, [&](size_t begin, size_t end)
+                        {
+        for (size_t idx = begin; idx < end; ++idx)
+        {
+            for (const ShardRoutes &shard : results)
+            {
+                for (uint32_t r = shard.offsets[idx]; r < shard.offsets[idx + 1]; ++r)
+                {
+                    routers[idx]->adoptRoute(shard.routes[r]);
+                }
+            }
+        } });
 }
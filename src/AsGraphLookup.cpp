@@ -0,0 +1,70 @@
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "AsGraph.h"
+
+using std::cerr, std::endl, std::vector, std::string;
+
+void AsGraph::buildPrefixIndex()
+{
+    prefixIndex.build(PrefixTable::global());
+    if (prefixIndex.skippedCount() > 0)
+    {
+        cerr << prefixIndex.skippedCount() << " prefixes could not be parsed and are not indexed" << endl;
+    }
+}
+
+vector<RouteMatch> AsGraph::lookupRoutes(const vector<string> &addresses, const vector<int> &asns) const
+{
+    vector<RouteMatch> results(addresses.size() * asns.size());
+
+    // resolve the ASNs once, nullptr for the unknown ones
+    vector<const LocalRib *> ribs(asns.size(), nullptr);
+    for (size_t col = 0; col < asns.size(); ++col)
+    {
+        long idx = indexOf(asns[col]);
+        if (idx >= 0 && static_cast<size_t>(idx) < routers.size())
+        {
+            ribs[col] = &routers[idx]->BGP::getlocalRib();
+        }
+    }
+
+    vector<uint32_t> candidates;
+    for (size_t row = 0; row < addresses.size(); ++row)
+    {
+        IpAddress address;
+        if (!PrefixIndex::parseAddress(addresses[row], address))
+        {
+            continue;
+        }
+
+        // one trie walk per address, shared by every AS
+        candidates.clear();
+        prefixIndex.matches(address, candidates);
+        if (candidates.empty())
+        {
+            continue;
+        }
+
+        RouteMatch *out = results.data() + row * asns.size();
+        for (size_t col = 0; col < asns.size(); ++col)
+        {
+            if (ribs[col] == nullptr)
+            {
+                continue;
+            }
+            // longest first, the first prefix the AS has a route for wins
+            for (uint32_t prefixId : candidates)
+            {
+                if (const Route *route = ribs[col]->findId(prefixId))
+                {
+                    out[col].prefixId = prefixId;
+                    out[col].route = *route;
+                    break;
+                }
+            }
+        }
+    }
+    return results;
+}
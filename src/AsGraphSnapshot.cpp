@@ -0,0 +1,353 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "AsGraph.h"
+#include "GraphSnapshot.h"
+#include "MappedFile.h"
+
+using std::cerr, std::endl, std::string, std::vector, std::ofstream;
+
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+// bytes per element of each section, in SnapshotSectionId order
+static constexpr size_t SECTION_ELEMENT_SIZE[SNAP_SECTION_COUNT] = {
+    sizeof(int32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t),
+    sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint64_t)};
+
+int AsGraph::saveSnapshot(const string &fileName)
+{
+    // re-rank so the stored ranks are guaranteed to match an acyclic graph
+    if (!flattenGraph())
+    {
+        cerr << "Refusing to snapshot a graph with a provider-customer cycle." << endl;
+        return -1;
+    }
+
+    // everything but the ROV bitmap is written straight from the topology and rank buffers
+    const vector<int32_t> &asns = topology.getAsns();
+    vector<uint64_t> rovBitmap((asns.size() + 63) / 64, 0);
+    for (size_t i = 0; i < asns.size(); ++i)
+    {
+        if (rovEnabledAsns.find(asns[i]) != rovEnabledAsns.end())
+        {
+            rovBitmap[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+
+    const CsrAdjacency &providers = topology.getProviderCsr();
+    const CsrAdjacency &customers = topology.getCustomerCsr();
+    const CsrAdjacency &peers = topology.getPeerCsr();
+    std::pair<const void *, size_t> data[SNAP_SECTION_COUNT] = {
+        {asns.data(), asns.size()},
+        {providers.offsets.data(), providers.offsets.size()},
+        {providers.neighbors.data(), providers.neighbors.size()},
+        {customers.offsets.data(), customers.offsets.size()},
+        {customers.neighbors.data(), customers.neighbors.size()},
+        {peers.offsets.data(), peers.offsets.size()},
+        {peers.neighbors.data(), peers.neighbors.size()},
+        {rankIndices.getItems().data(), rankIndices.getItems().size()},
+        {rankIndices.getOffsets().data(), rankIndices.getOffsets().size()},
+        {rovBitmap.data(), rovBitmap.size()}};
+
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.asCount = asns.size();
+    header.rankCount = rankIndices.size();
+    uint64_t offset = alignUp(sizeof(SnapshotHeader));
+    for (int id = 0; id < SNAP_SECTION_COUNT; ++id)
+    {
+        header.sections[id] = {offset, data[id].second};
+        offset = alignUp(offset + data[id].second * SECTION_ELEMENT_SIZE[id]);
+    }
+    header.fileSize = offset;
+
+    ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        cerr << "Error opening the file " << fileName << endl;
+        return -1;
+    }
+
+    // zero padding up to each section start and after the last one
+    static const char zeros[8] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (int id = 0; id < SNAP_SECTION_COUNT; ++id)
+    {
+        out.write(zeros, header.sections[id].offset - static_cast<uint64_t>(out.tellp()));
+        out.write(static_cast<const char *>(data[id].first), data[id].second * SECTION_ELEMENT_SIZE[id]);
+    }
+    out.write(zeros, header.fileSize - static_cast<uint64_t>(out.tellp()));
+
+    return out.good() ? 0 : -1;
+}
+
+// checks that offsets is a CSR offsets array over n ASes whose neighbors are all valid indices
+static bool validCsr(const uint32_t *offsets, const uint32_t *neighbors, uint64_t neighborCount, uint64_t n)
+{
+    if (offsets[0] != 0 || offsets[n] != neighborCount)
+    {
+        return false;
+    }
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        if (offsets[i] > offsets[i + 1])
+        {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < neighborCount; ++i)
+    {
+        if (neighbors[i] >= n)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+Whether back holds exactly the reversed edges of fwd: for every edge i -> j
+in fwd, i is in j's range of back, as often as the edge appears. The
+reversed edges are laid out in back's ranges (in increasing i, so already
+sorted) and compared with a sorted copy of back. Both must be valid CSRs
+over n ASes.
+ */
+static bool mirrorsCsr(const uint32_t *fwdOffsets, const uint32_t *fwdNeighbors, const uint32_t *backOffsets,
+                       const uint32_t *backNeighbors, uint64_t count, uint64_t n)
+{
+    if (fwdOffsets[n] != count || backOffsets[n] != count)
+    {
+        return false;
+    }
+    vector<uint32_t> cursor(backOffsets, backOffsets + n);
+    vector<uint32_t> reversed(count);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t e = fwdOffsets[i]; e < fwdOffsets[i + 1]; ++e)
+        {
+            uint32_t j = fwdNeighbors[e];
+            if (cursor[j] == backOffsets[j + 1])
+            {
+                return false; // more edges into j than j's range holds
+            }
+            reversed[cursor[j]++] = i;
+        }
+    }
+    // the totals match and no range overflowed, so every range is full
+    vector<uint32_t> stored(backNeighbors, backNeighbors + count);
+    for (uint64_t j = 0; j < n; ++j)
+    {
+        std::sort(stored.begin() + backOffsets[j], stored.begin() + backOffsets[j + 1]);
+    }
+    return stored == reversed;
+}
+
+// copies a validated CSR section pair out of the mapping
+static CsrAdjacency copyCsr(const uint32_t *offsets, const uint32_t *neighbors, uint64_t neighborCount, uint64_t n)
+{
+    CsrAdjacency csr;
+    csr.offsets.assign(offsets, offsets + n + 1);
+    csr.neighbors.assign(neighbors, neighbors + neighborCount);
+    return csr;
+}
+
+int AsGraph::loadSnapshot(const string &fileName)
+{
+    if (!asNodes.empty())
+    {
+        cerr << "A snapshot can only be loaded into an empty graph." << endl;
+        return -1;
+    }
+
+    MappedFile file;
+    if (!file.open(fileName))
+    {
+        cerr << "Error opening the file " << fileName << endl;
+        return -1;
+    }
+
+    const char *base = file.begin();
+    SnapshotHeader header;
+    if (file.size() < sizeof(header))
+    {
+        cerr << "Snapshot " << fileName << " is truncated." << endl;
+        return -1;
+    }
+    memcpy(&header, base, sizeof(header));
+
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+    {
+        cerr << "File " << fileName << " is not a graph snapshot." << endl;
+        return -1;
+    }
+    if (header.version != SNAPSHOT_VERSION)
+    {
+        cerr << "Snapshot " << fileName << " has version " << header.version
+             << ", expected " << SNAPSHOT_VERSION << "." << endl;
+        return -1;
+    }
+
+    auto corrupt = [&fileName](const char *what)
+    {
+        cerr << "Snapshot " << fileName << " has " << what << "." << endl;
+        return -1;
+    };
+
+    /*
+    Nothing below touches the graph until every section has been checked:
+    sizes and bounds first, then the contents.
+     */
+    const uint64_t n = header.asCount;
+    if (header.fileSize != file.size() || n >= UINT32_MAX || header.rankCount > n + 1)
+    {
+        return corrupt("a bad header");
+    }
+    // the neighbor arrays are as long as the file says (ANY)
+    const uint64_t ANY = UINT64_MAX;
+    const uint64_t expected[SNAP_SECTION_COUNT] = {n, n + 1, ANY, n + 1, ANY, n + 1, ANY, n, header.rankCount + 1, (n + 63) / 64};
+    for (int id = 0; id < SNAP_SECTION_COUNT; ++id)
+    {
+        const SnapshotSection &section = header.sections[id];
+        if (section.offset % 8 != 0 || section.offset < sizeof(header) || section.offset > header.fileSize ||
+            section.count > (header.fileSize - section.offset) / SECTION_ELEMENT_SIZE[id] ||
+            (expected[id] != ANY && section.count != expected[id]) || section.count >= UINT32_MAX)
+        {
+            return corrupt("a truncated or misplaced section");
+        }
+    }
+
+    auto section = [&](SnapshotSectionId id)
+    {
+        return base + header.sections[id].offset;
+    };
+    const int32_t *asns = reinterpret_cast<const int32_t *>(section(SNAP_ASNS));
+    const uint32_t *csrOffsets[3], *csrNeighbors[3];
+    uint64_t csrCounts[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        SnapshotSectionId offsetsId = static_cast<SnapshotSectionId>(SNAP_PROVIDER_OFFSETS + 2 * c);
+        csrOffsets[c] = reinterpret_cast<const uint32_t *>(section(offsetsId));
+        csrNeighbors[c] = reinterpret_cast<const uint32_t *>(section(static_cast<SnapshotSectionId>(offsetsId + 1)));
+        csrCounts[c] = header.sections[offsetsId + 1].count;
+    }
+    const uint32_t *rankItems = reinterpret_cast<const uint32_t *>(section(SNAP_RANK_INDICES));
+    const uint32_t *rankOffsets = reinterpret_cast<const uint32_t *>(section(SNAP_RANK_OFFSETS));
+    const uint64_t *rovBitmap = reinterpret_cast<const uint64_t *>(section(SNAP_ROV_BITMAP));
+    const uint32_t *providerOffsets = csrOffsets[0], *customerOffsets = csrOffsets[1], *peerOffsets = csrOffsets[2];
+
+    vector<int> sortedAsns(asns, asns + n);
+    std::sort(sortedAsns.begin(), sortedAsns.end());
+    if (std::adjacent_find(sortedAsns.begin(), sortedAsns.end()) != sortedAsns.end())
+    {
+        return corrupt("a repeated ASN");
+    }
+
+    for (int c = 0; c < 3; ++c)
+    {
+        if (!validCsr(csrOffsets[c], csrNeighbors[c], csrCounts[c], n))
+        {
+            return corrupt("corrupt neighbor arrays");
+        }
+    }
+
+    // every customer edge has its provider edge and every peer edge its way back
+    if (!mirrorsCsr(customerOffsets, csrNeighbors[1], providerOffsets, csrNeighbors[0], csrCounts[0], n) ||
+        !mirrorsCsr(peerOffsets, csrNeighbors[2], peerOffsets, csrNeighbors[2], csrCounts[2], n))
+    {
+        return corrupt("neighbor arrays that do not mirror each other");
+    }
+
+    if (rankOffsets[0] != 0 || rankOffsets[header.rankCount] != n)
+    {
+        return corrupt("corrupt rank offsets");
+    }
+    vector<uint32_t> ranks(n, UINT32_MAX);
+    for (uint64_t r = 0; r < header.rankCount; ++r)
+    {
+        if (rankOffsets[r] > rankOffsets[r + 1])
+        {
+            return corrupt("corrupt rank offsets");
+        }
+        for (uint32_t i = rankOffsets[r]; i < rankOffsets[r + 1]; ++i)
+        {
+            if (rankItems[i] >= n || ranks[rankItems[i]] != UINT32_MAX)
+            {
+                return corrupt("ranks that do not cover every AS once");
+            }
+            ranks[rankItems[i]] = static_cast<uint32_t>(r);
+        }
+    }
+    /*
+    Ranks were computed (and checked for cycles) when the snapshot was
+    written. The provider arrays mirror the customer ones, so checking the
+    customer edges covers every provider edge too.
+     */
+    for (uint64_t idx = 0; idx < n; ++idx)
+    {
+        for (uint32_t i = customerOffsets[idx]; i < customerOffsets[idx + 1]; ++i)
+        {
+            if (ranks[csrNeighbors[1][i]] >= ranks[idx])
+            {
+                return corrupt("a provider ranked at or below its customer");
+            }
+        }
+    }
+
+    // the file is sound, adopt it
+    auto deploysRov = [rovBitmap](uint64_t idx)
+    {
+        return (rovBitmap[idx / 64] & (uint64_t(1) << (idx % 64))) != 0;
+    };
+    asMap.reserve(n);
+    for (uint32_t idx = 0; idx < n; ++idx)
+    {
+        if (deploysRov(idx))
+        {
+            rovEnabledAsns.insert(asns[idx]);
+        }
+        asMap.emplace(asns[idx], &asNodes.emplace_back(asns[idx], deploysRov(idx), idx, routeResource, &paths));
+    }
+
+    // the neighbor vectors are the editable copy incremental updates work on
+    for (uint32_t idx = 0; idx < n; ++idx)
+    {
+        AS &as = asNodes[idx];
+        for (uint32_t i = providerOffsets[idx]; i < providerOffsets[idx + 1]; ++i)
+        {
+            as.addProvider(asns[csrNeighbors[0][i]]);
+        }
+        for (uint32_t i = customerOffsets[idx]; i < customerOffsets[idx + 1]; ++i)
+        {
+            as.addCustomer(asns[csrNeighbors[1][i]]);
+        }
+        for (uint32_t i = peerOffsets[idx]; i < peerOffsets[idx + 1]; ++i)
+        {
+            as.addPeer(asns[csrNeighbors[2][i]]);
+        }
+    }
+
+    topology.adopt(vector<int>(asns, asns + n), copyCsr(csrOffsets[0], csrNeighbors[0], csrCounts[0], n),
+                   copyCsr(csrOffsets[1], csrNeighbors[1], csrCounts[1], n),
+                   copyCsr(csrOffsets[2], csrNeighbors[2], csrCounts[2], n));
+    indexRouters();
+
+    // keep the stored order within each rank
+    rankOf = std::move(ranks);
+    vector<uint32_t> offsets(rankOffsets, rankOffsets + header.rankCount + 1);
+    vector<int> rankAsns(n);
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        rankAsns[i] = asns[rankItems[i]];
+    }
+    rankIndices.assign(vector<uint32_t>(rankItems, rankItems + n), offsets);
+    flattenedGraph.assign(std::move(rankAsns), std::move(offsets));
+    return 0;
+}
@@ -0,0 +1,249 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+#include "AsGraph.h"
+
+using std::cerr, std::endl, std::vector, std::unordered_map;
+
+bool AsGraph::findEdge(int srcAsn, int dstAsn, RelationshipType &relType) const
+{
+    auto it = asMap.find(srcAsn);
+    if (it == asMap.end())
+    {
+        return false;
+    }
+    // a provider-to-customer line lives on the provider side, a peer line on both
+    const AS *src = it->second;
+    if (std::find(src->getCustomers().begin(), src->getCustomers().end(), dstAsn) != src->getCustomers().end())
+    {
+        relType = RelationshipType::PROVIDER_TO_CUSTOMER;
+        return true;
+    }
+    if (std::find(src->getPeers().begin(), src->getPeers().end(), dstAsn) != src->getPeers().end())
+    {
+        relType = RelationshipType::PEER_TO_PEER;
+        return true;
+    }
+    return false;
+}
+
+void AsGraph::removeEdge(int srcAsn, int dstAsn, RelationshipType relType)
+{
+    AS *srcAs = asMap.at(srcAsn);
+    AS *dstAs = asMap.at(dstAsn);
+
+    if (relType == RelationshipType::PEER_TO_PEER)
+    {
+        srcAs->removePeer(dstAsn);
+        dstAs->removePeer(srcAsn);
+    }
+    else if (relType == RelationshipType::PROVIDER_TO_CUSTOMER)
+    {
+        srcAs->removeCustomer(dstAsn);
+        dstAs->removeProvider(srcAsn);
+    }
+}
+
+bool AsGraph::closesCycle(AS *provider, AS *customer)
+{
+    int providerAsn = provider->getAsn();
+    if (provider == customer)
+    {
+        cycle = {providerAsn, providerAsn};
+        return true;
+    }
+
+    // every AS that can reach the provider through customer edges outranks it
+    uint32_t providerRank = rankOf[provider->getIndex()];
+    if (rankOf[customer->getIndex()] <= providerRank)
+    {
+        return false;
+    }
+
+    unordered_map<int, int> reachedFrom; // visited ASN -> ASN it was reached from
+    reachedFrom[customer->getAsn()] = providerAsn;
+    vector<AS *> stack = {customer};
+    while (!stack.empty())
+    {
+        AS *as = stack.back();
+        stack.pop_back();
+        for (int cAsn : as->getCustomers())
+        {
+            if (cAsn == providerAsn)
+            {
+                // walk back to the new edge: provider -> customer -> ... -> as -> provider
+                vector<int> path;
+                for (int asn = as->getAsn(); asn != providerAsn; asn = reachedFrom[asn])
+                {
+                    path.push_back(asn);
+                }
+                cycle.assign(1, providerAsn);
+                cycle.insert(cycle.end(), path.rbegin(), path.rend());
+                cycle.push_back(providerAsn);
+                return true;
+            }
+
+            AS *next = asMap.at(cAsn);
+            if (rankOf[next->getIndex()] > providerRank && reachedFrom.try_emplace(cAsn, as->getAsn()).second)
+            {
+                stack.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+void AsGraph::rerankProviderCone(int asn)
+{
+    // collect asn and everything above it, counting customers inside that cone
+    AS *start = asMap.at(asn);
+    vector<AS *> cone = {start};
+    unordered_map<int, uint32_t> pending = {{asn, 0}};
+    for (size_t i = 0; i < cone.size(); ++i)
+    {
+        for (int pAsn : cone[i]->getProviders())
+        {
+            auto [it, inserted] = pending.try_emplace(pAsn, 0);
+            ++it->second;
+            if (inserted)
+            {
+                cone.push_back(asMap.at(pAsn));
+            }
+        }
+    }
+
+    // same countdown as flattenGraph, customers outside the cone keep their ranks
+    vector<AS *> queue = {start};
+    queue.reserve(cone.size());
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        AS *as = queue[head];
+        uint32_t rank = 0;
+        for (int cAsn : as->getCustomers())
+        {
+            rank = std::max(rank, rankOf[asMap.at(cAsn)->getIndex()] + 1);
+        }
+        rankOf[as->getIndex()] = rank;
+
+        for (int pAsn : as->getProviders())
+        {
+            if (--pending[pAsn] == 0)
+            {
+                queue.push_back(asMap.at(pAsn));
+            }
+        }
+    }
+}
+
+int AsGraph::addRelationship(int srcAsn, int dstAsn, RelationshipType relType)
+{
+    if (rankOf.size() != asNodes.size())
+    {
+        cerr << "The graph has to be flattened before it can be updated." << endl;
+        return -1;
+    }
+
+    RelationshipType existing;
+    if (findEdge(srcAsn, dstAsn, existing) || findEdge(dstAsn, srcAsn, existing))
+    {
+        cerr << "AS " << srcAsn << " and AS " << dstAsn << " already have a relationship." << endl;
+        return -1;
+    }
+
+    if (relType == RelationshipType::PROVIDER_TO_CUSTOMER)
+    {
+        auto srcIt = asMap.find(srcAsn);
+        auto dstIt = asMap.find(dstAsn);
+        // a new AS has no provider or customer edges yet, so it cannot be on a cycle
+        if (srcIt != asMap.end() && dstIt != asMap.end() && closesCycle(srcIt->second, dstIt->second))
+        {
+            cerr << "Adding " << srcAsn << "|" << dstAsn << " would create a provider-customer cycle." << endl;
+            return -1;
+        }
+    }
+
+    addEdge(srcAsn, dstAsn, relType);
+    // new ASes start out as stubs
+    rankOf.resize(asNodes.size(), 0);
+    if (relType == RelationshipType::PROVIDER_TO_CUSTOMER)
+    {
+        rerankProviderCone(srcAsn);
+    }
+    return 0;
+}
+
+int AsGraph::removeRelationship(int srcAsn, int dstAsn)
+{
+    if (rankOf.size() != asNodes.size())
+    {
+        cerr << "The graph has to be flattened before it can be updated." << endl;
+        return -1;
+    }
+
+    RelationshipType relType;
+    if (!findEdge(srcAsn, dstAsn, relType))
+    {
+        if (!findEdge(dstAsn, srcAsn, relType))
+        {
+            cerr << "AS " << srcAsn << " and AS " << dstAsn << " have no relationship." << endl;
+            return -1;
+        }
+        std::swap(srcAsn, dstAsn);
+    }
+
+    removeEdge(srcAsn, dstAsn, relType);
+    if (relType == RelationshipType::PROVIDER_TO_CUSTOMER)
+    {
+        rerankProviderCone(srcAsn);
+    }
+    return 0;
+}
+
+int AsGraph::retypeRelationship(int srcAsn, int dstAsn, RelationshipType relType)
+{
+    if (rankOf.size() != asNodes.size())
+    {
+        cerr << "The graph has to be flattened before it can be updated." << endl;
+        return -1;
+    }
+
+    int oldSrc = srcAsn;
+    int oldDst = dstAsn;
+    RelationshipType oldType;
+    if (!findEdge(oldSrc, oldDst, oldType))
+    {
+        if (!findEdge(oldDst, oldSrc, oldType))
+        {
+            cerr << "AS " << srcAsn << " and AS " << dstAsn << " have no relationship." << endl;
+            return -1;
+        }
+        std::swap(oldSrc, oldDst);
+    }
+    if (oldType == relType && (oldSrc == srcAsn || relType == RelationshipType::PEER_TO_PEER))
+    {
+        return 0;
+    }
+
+    removeRelationship(oldSrc, oldDst);
+    if (addRelationship(srcAsn, dstAsn, relType) != 0)
+    {
+        // put the old edge back, it cannot close a cycle since it was there before
+        addRelationship(oldSrc, oldDst, oldType);
+        return -1;
+    }
+    return 0;
+}
+
+void AsGraph::commitUpdates()
+{
+    buildTopology();
+
+    uint32_t rankCount = 0;
+    for (uint32_t rank : rankOf)
+    {
+        rankCount = std::max(rankCount, rank + 1);
+    }
+    layoutRanks(rankCount);
+}
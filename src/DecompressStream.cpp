@@ -0,0 +1,249 @@
+#include <cstdio>
+#include <cstring>
+#include <bzlib.h>
+#include <zlib.h>
+
+#include "DecompressStream.h"
+
+using std::unique_lock, std::lock_guard;
+
+Compression detectCompression(const string &fileName)
+{
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return Compression::NONE;
+    }
+
+    unsigned char magic[3] = {};
+    size_t got = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    if (got >= 3 && magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h')
+    {
+        return Compression::BZIP2;
+    }
+    if (got >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+        return Compression::GZIP;
+    }
+    return Compression::NONE;
+}
+
+DecompressStream::~DecompressStream()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    slotFree.notify_all();
+    if (producer.joinable())
+    {
+        producer.join();
+    }
+}
+
+bool DecompressStream::open(const string &fileName, Compression compression)
+{
+    FILE *probe = fopen(fileName.c_str(), "rb");
+    if (probe == nullptr)
+    {
+        return false;
+    }
+    fclose(probe);
+
+    producer = thread(&DecompressStream::produce, this, fileName, compression);
+    return true;
+}
+
+bool DecompressStream::acquireBuffer(vector<char> &buffer)
+{
+    unique_lock<mutex> guard(lock);
+    slotFree.wait(guard, [this]
+                  { return stopping || full.size() < maxQueued; });
+    if (stopping)
+    {
+        return false;
+    }
+    if (!spare.empty())
+    {
+        buffer = std::move(spare.back());
+        spare.pop_back();
+    }
+    buffer.resize(blockSize);
+    return true;
+}
+
+bool DecompressStream::pushBlock(vector<char> &&buffer)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        if (stopping)
+        {
+            return false;
+        }
+        full.push_back(std::move(buffer));
+    }
+    blockReady.notify_one();
+    return true;
+}
+
+void DecompressStream::finish(bool error)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        done = true;
+        failed = error;
+    }
+    blockReady.notify_one();
+}
+
+void DecompressStream::produce(string fileName, Compression compression)
+{
+    if (compression == Compression::GZIP || compression == Compression::NONE)
+    {
+        // gzread handles concatenated members and passes plain files through untouched
+        gzFile gz = gzopen(fileName.c_str(), "rb");
+        if (gz == nullptr)
+        {
+            finish(true);
+            return;
+        }
+        gzbuffer(gz, 1 << 17);
+
+        bool error = false;
+        vector<char> buffer;
+        while (acquireBuffer(buffer))
+        {
+            int got = gzread(gz, buffer.data(), static_cast<unsigned>(buffer.size()));
+            if (got < 0)
+            {
+                error = true;
+                break;
+            }
+            if (got == 0)
+            {
+                break;
+            }
+            buffer.resize(got);
+            if (!pushBlock(std::move(buffer)))
+            {
+                break;
+            }
+        }
+        gzclose(gz);
+        finish(error);
+        return;
+    }
+
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (file == nullptr)
+    {
+        finish(true);
+        return;
+    }
+
+    vector<char> input(1 << 17);
+    bz_stream bz;
+    memset(&bz, 0, sizeof(bz));
+    bool error = BZ2_bzDecompressInit(&bz, 0, 0) != BZ_OK;
+    bool eof = false;
+    bool midStream = false; // input was fed since the last end-of-stream marker
+
+    vector<char> buffer;
+    while (!error && acquireBuffer(buffer))
+    {
+        bz.next_out = buffer.data();
+        bz.avail_out = static_cast<unsigned>(buffer.size());
+
+        // fill the whole output block unless the input runs out
+        while (bz.avail_out > 0)
+        {
+            if (bz.avail_in == 0 && !eof)
+            {
+                size_t got = fread(input.data(), 1, input.size(), file);
+                eof = got < input.size();
+                bz.next_in = input.data();
+                bz.avail_in = static_cast<unsigned>(got);
+            }
+            if (bz.avail_in == 0 && eof)
+            {
+                // running out of input inside a stream means the file is truncated
+                error = midStream;
+                break;
+            }
+
+            midStream = true;
+            int ret = BZ2_bzDecompress(&bz);
+            if (ret == BZ_STREAM_END)
+            {
+                midStream = false;
+                // multi-stream files (e.g. from pbzip2): restart on the remaining input
+                BZ2_bzDecompressEnd(&bz);
+                char *nextIn = bz.next_in;
+                unsigned availIn = bz.avail_in;
+                char *nextOut = bz.next_out;
+                unsigned availOut = bz.avail_out;
+                memset(&bz, 0, sizeof(bz));
+                if (BZ2_bzDecompressInit(&bz, 0, 0) != BZ_OK)
+                {
+                    error = true;
+                    break;
+                }
+                bz.next_in = nextIn;
+                bz.avail_in = availIn;
+                bz.next_out = nextOut;
+                bz.avail_out = availOut;
+            }
+            else if (ret != BZ_OK)
+            {
+                error = true;
+                break;
+            }
+        }
+
+        size_t produced = buffer.size() - bz.avail_out;
+        if (produced == 0)
+        {
+            break;
+        }
+        buffer.resize(produced);
+        if (!pushBlock(std::move(buffer)))
+        {
+            break;
+        }
+    }
+
+    BZ2_bzDecompressEnd(&bz);
+    fclose(file);
+    finish(error);
+}
+
+bool DecompressStream::next(vector<char> &block)
+{
+    unique_lock<mutex> guard(lock);
+    blockReady.wait(guard, [this]
+                    { return !full.empty() || done; });
+    if (full.empty())
+    {
+        return false;
+    }
+
+    if (block.capacity() > 0)
+    {
+        block.clear();
+        spare.push_back(std::move(block));
+    }
+    block = std::move(full.front());
+    full.pop_front();
+    guard.unlock();
+
+    slotFree.notify_one();
+    return true;
+}
+
+bool DecompressStream::hasError()
+{
+    lock_guard<mutex> guard(lock);
+    return failed;
+}
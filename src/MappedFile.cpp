@@ -0,0 +1,65 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedFile.h"
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const string &fileName)
+{
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0)
+    {
+        // mmap rejects zero-length mappings, an empty file is just an empty range
+        ::close(fd);
+        data = "";
+        return true;
+    }
+
+    void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        length = 0;
+        return false;
+    }
+
+    // we scan front to back exactly once
+    madvise(addr, length, MADV_SEQUENTIAL);
+
+    data = static_cast<const char *>(addr);
+    mapped = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mapped)
+    {
+        munmap(const_cast<char *>(data), length);
+    }
+    data = nullptr;
+    length = 0;
+    mapped = false;
+}
@@ -0,0 +1,191 @@
+#include "PathPool.h"
+
+using std::lock_guard;
+
+thread_local PathPool::CachedIndex PathPool::cached;
+
+PathPool::PathPool() : chunks(new atomic<PathNode *>[MAX_CHUNKS]), generation(nextGeneration())
+{
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i)
+    {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+    // node 0 is the empty path
+    PathNode *first = new PathNode[CHUNK_SIZE];
+    first[0] = {0, 0, 0};
+    chunks[0].store(first, std::memory_order_release);
+}
+
+PathPool::~PathPool()
+{
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i)
+    {
+        delete[] chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+PathPool &PathPool::global()
+{
+    static PathPool pool;
+    return pool;
+}
+
+uint64_t PathPool::nextGeneration()
+{
+    static atomic<uint64_t> counter{1};
+    return counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t PathPool::hashHop(int asn, uint32_t parent)
+{
+    // splitmix64 finalizer over (parent, asn)
+    uint64_t x = (uint64_t(parent) << 32) | static_cast<uint32_t>(asn);
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+PathPool::ThreadIndex &PathPool::threadIndex()
+{
+    uint64_t current = generation.load(std::memory_order_acquire);
+    if (cached.generation == current)
+    {
+        return *cached.index;
+    }
+
+    // first prepend of this thread on this pool since its last reset (or it used another pool since)
+    lock_guard<mutex> guard(lock);
+    std::thread::id self = std::this_thread::get_id();
+    ThreadIndex *index = nullptr;
+    for (unique_ptr<ThreadIndex> &ti : indexes)
+    {
+        if (ti->owner == self)
+        {
+            index = ti.get();
+            break;
+        }
+    }
+    if (index == nullptr)
+    {
+        indexes.push_back(std::make_unique<ThreadIndex>());
+        index = indexes.back().get();
+        index->owner = self;
+        index->slots.assign(1024, 0);
+    }
+    cached = {current, index};
+    return *index;
+}
+
+uint32_t PathPool::allocate(int asn, uint32_t parent)
+{
+    uint32_t id = nextNode.fetch_add(1, std::memory_order_relaxed);
+    uint32_t chunk = id >> CHUNK_BITS;
+    if (chunks[chunk].load(std::memory_order_acquire) == nullptr)
+    {
+        // the first thread to reach a new chunk installs it, a racing one drops its copy
+        PathNode *fresh = new PathNode[CHUNK_SIZE];
+        PathNode *expected = nullptr;
+        if (!chunks[chunk].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel))
+        {
+            delete[] fresh;
+        }
+    }
+    nodeAt(id) = {asn, parent, nodeAt(parent).length + 1};
+    return id;
+}
+
+void PathPool::grow(ThreadIndex &index)
+{
+    vector<uint32_t> old = std::move(index.slots);
+    index.slots.assign(old.size() * 2, 0);
+    size_t mask = index.slots.size() - 1;
+    for (uint32_t id : old)
+    {
+        if (id == 0)
+        {
+            continue;
+        }
+        const PathNode &node = nodeAt(id);
+        size_t pos = hashHop(node.asn, node.parent) & mask;
+        while (index.slots[pos] != 0)
+        {
+            pos = (pos + 1) & mask;
+        }
+        index.slots[pos] = id;
+    }
+}
+
+PathHandle PathPool::prepend(int asn, PathHandle path)
+{
+    ThreadIndex &index = threadIndex();
+    uint64_t hash = hashHop(asn, path.node);
+
+    size_t mask = index.slots.size() - 1;
+    size_t pos = hash & mask;
+    while (index.slots[pos] != 0)
+    {
+        const PathNode &node = nodeAt(index.slots[pos]);
+        if (node.asn == asn && node.parent == path.node)
+        {
+            return PathHandle::fromNode(index.slots[pos]);
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    uint32_t id = allocate(asn, path.node);
+    index.slots[pos] = id;
+    // keep the load factor under 1/2 so probes stay short
+    if (++index.used * 2 > index.slots.size())
+    {
+        grow(index);
+    }
+    return PathHandle::fromNode(id);
+}
+
+PathHandle PathPool::intern(const vector<int> &path)
+{
+    PathHandle handle;
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+    {
+        handle = prepend(*it, handle);
+    }
+    return handle;
+}
+
+vector<int> PathPool::toVector(PathHandle path) const
+{
+    vector<int> asns;
+    asns.reserve(length(path));
+    walk(path, [&asns](int asn)
+         { asns.push_back(asn); });
+    return asns;
+}
+
+void PathPool::reset()
+{
+    lock_guard<mutex> guard(lock);
+    // a new generation makes every thread's cached index miss
+    generation.store(nextGeneration(), std::memory_order_release);
+    indexes.clear();
+    // chunk 0 holds the empty path, the rest go back to the heap
+    for (uint32_t i = 1; i < MAX_CHUNKS; ++i)
+    {
+        delete[] chunks[i].exchange(nullptr, std::memory_order_relaxed);
+    }
+    nextNode.store(1, std::memory_order_relaxed);
+}
+
+size_t PathPool::memoryBytes()
+{
+    size_t bytes = MAX_CHUNKS * sizeof(atomic<PathNode *>);
+    bytes += ((size() + CHUNK_SIZE - 1) / CHUNK_SIZE) * CHUNK_SIZE * sizeof(PathNode);
+    lock_guard<mutex> guard(lock);
+    for (const unique_ptr<ThreadIndex> &index : indexes)
+    {
+        bytes += index->slots.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,243 @@
+#include <arpa/inet.h>
+#include <charconv>
+#include <algorithm>
+
+#include "PrefixIndex.h"
+
+// keeps the first length bits of key
+static IpAddress maskTo(IpAddress key, uint32_t length)
+{
+    if (length == 0)
+    {
+        key.hi = 0;
+        key.lo = 0;
+    }
+    else if (length <= 64)
+    {
+        key.hi &= ~uint64_t(0) << (64 - length);
+        key.lo = 0;
+    }
+    else if (length < 128)
+    {
+        key.lo &= ~uint64_t(0) << (128 - length);
+    }
+    return key;
+}
+
+// leading bits a and b share, at most limit
+static uint32_t commonLength(const IpAddress &a, const IpAddress &b, uint32_t limit)
+{
+    uint64_t diff = a.hi ^ b.hi;
+    uint32_t common = 0;
+    if (diff != 0)
+    {
+        common = __builtin_clzll(diff);
+    }
+    else
+    {
+        diff = a.lo ^ b.lo;
+        common = diff != 0 ? 64 + __builtin_clzll(diff) : 128;
+    }
+    return std::min(common, limit);
+}
+
+bool PrefixIndex::parseAddress(const string &text, IpAddress &address)
+{
+    unsigned char bytes[16];
+    if (inet_pton(AF_INET, text.c_str(), bytes) == 1)
+    {
+        address.hi = (uint64_t(bytes[0]) << 56) | (uint64_t(bytes[1]) << 48) |
+                     (uint64_t(bytes[2]) << 40) | (uint64_t(bytes[3]) << 32);
+        address.lo = 0;
+        address.v6 = false;
+        return true;
+    }
+    if (inet_pton(AF_INET6, text.c_str(), bytes) == 1)
+    {
+        address.hi = 0;
+        address.lo = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            address.hi = (address.hi << 8) | bytes[i];
+            address.lo = (address.lo << 8) | bytes[i + 8];
+        }
+        address.v6 = true;
+        return true;
+    }
+    return false;
+}
+
+bool PrefixIndex::parsePrefix(const string &text, IpAddress &address, uint32_t &length)
+{
+    size_t slash = text.find('/');
+    if (slash == string::npos || !parseAddress(text.substr(0, slash), address))
+    {
+        return false;
+    }
+
+    const char *first = text.data() + slash + 1;
+    const char *last = text.data() + text.size();
+    auto [end, ec] = std::from_chars(first, last, length);
+    if (ec != std::errc() || end != last || first == last || length > (address.v6 ? 128u : 32u))
+    {
+        return false;
+    }
+    // host bits are ignored, 10.1.2.3/16 is 10.1.0.0/16
+    address = maskTo(address, length);
+    return true;
+}
+
+uint32_t PrefixIndex::newNode(const IpAddress &key, uint32_t length, uint32_t prefixId)
+{
+    Node node;
+    node.key = key;
+    node.length = length;
+    node.prefixId = prefixId;
+    nodes.push_back(node);
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void PrefixIndex::insert(const IpAddress &key, uint32_t length, uint32_t prefixId)
+{
+    /*
+    parent and side name the link that points at curr (parent NONE is the
+    root), kept as indices because newNode may move the node vector.
+     */
+    uint32_t parent = NONE;
+    int side = 0;
+    uint32_t curr = roots[key.v6 ? 1 : 0];
+
+    auto relink = [&](uint32_t node)
+    {
+        if (parent == NONE)
+        {
+            roots[key.v6 ? 1 : 0] = node;
+        }
+        else
+        {
+            nodes[parent].child[side] = node;
+        }
+    };
+
+    while (true)
+    {
+        if (curr == NONE)
+        {
+            relink(newNode(key, length, prefixId));
+            ++prefixCount;
+            return;
+        }
+
+        uint32_t currLength = nodes[curr].length;
+        IpAddress currKey = nodes[curr].key;
+        uint32_t common = commonLength(key, currKey, std::min(length, currLength));
+
+        if (common == currLength && common == length)
+        {
+            if (nodes[curr].prefixId == NONE)
+            {
+                nodes[curr].prefixId = prefixId;
+            }
+            else
+            {
+                // the same prefix written differently, ids arrive in order so it goes last
+                uint32_t last = nodes[curr].prefixId;
+                while (sameAs[last] != NONE)
+                {
+                    last = sameAs[last];
+                }
+                sameAs[last] = prefixId;
+            }
+            ++prefixCount;
+            return;
+        }
+
+        if (common == currLength)
+        {
+            // curr contains the new prefix, go down
+            parent = curr;
+            side = key.bit(currLength);
+            curr = nodes[curr].child[side];
+            continue;
+        }
+
+        if (common == length)
+        {
+            // the new prefix contains curr, it goes in between
+            uint32_t node = newNode(key, length, prefixId);
+            nodes[node].child[currKey.bit(length)] = curr;
+            relink(node);
+            ++prefixCount;
+            return;
+        }
+
+        // they diverge below both, add a branch node where they split
+        uint32_t branch = newNode(maskTo(key, common), common, NONE);
+        uint32_t leaf = newNode(key, length, prefixId);
+        nodes[branch].child[key.bit(common)] = leaf;
+        nodes[branch].child[currKey.bit(common)] = curr;
+        relink(branch);
+        ++prefixCount;
+        return;
+    }
+}
+
+void PrefixIndex::build(const PrefixTable &table)
+{
+    clear();
+    nodes.reserve(table.size() * 2);
+    sameAs.assign(table.size(), NONE);
+    for (uint32_t id = 0; id < table.size(); ++id)
+    {
+        IpAddress key;
+        uint32_t length = 0;
+        if (!parsePrefix(table.get(id), key, length))
+        {
+            ++skipped;
+            continue;
+        }
+        insert(key, length, id);
+    }
+}
+
+void PrefixIndex::clear()
+{
+    nodes.clear();
+    sameAs.clear();
+    roots[0] = NONE;
+    roots[1] = NONE;
+    prefixCount = 0;
+    skipped = 0;
+}
+
+void PrefixIndex::matches(const IpAddress &address, vector<uint32_t> &matches) const
+{
+    size_t first = matches.size();
+    uint32_t maxLength = address.v6 ? 128 : 32;
+    uint32_t curr = roots[address.v6 ? 1 : 0];
+    while (curr != NONE)
+    {
+        const Node &node = nodes[curr];
+        if (commonLength(address, node.key, node.length) < node.length)
+        {
+            break;
+        }
+        if (node.prefixId != NONE)
+        {
+            // highest id first, the reverse below puts them back in order
+            size_t from = matches.size();
+            for (uint32_t id = node.prefixId; id != NONE; id = sameAs[id])
+            {
+                matches.push_back(id);
+            }
+            std::reverse(matches.begin() + from, matches.end());
+        }
+        if (node.length == maxLength)
+        {
+            break;
+        }
+        curr = node.child[address.bit(node.length)];
+    }
+    // collected from the root down, callers want the longest first
+    std::reverse(matches.begin() + first, matches.end());
+}
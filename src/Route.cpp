@@ -0,0 +1,98 @@
+#include "Route.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ROUTE_HAVE_AVX2 1
+#endif
+
+/*
+rankKey() of a route from its high 8 bytes, q = meta << 32 | next hop:
+the relationship sits in bits 62-63 of q and moves to 61-62 inverted,
+length and next hop are already where the key wants them.
+ */
+static constexpr uint64_t KEY_REL_BITS = uint64_t(3) << 62;
+static constexpr uint64_t KEY_KEEP_BITS = (uint64_t((1u << 29) - 1) << 32) | 0xFFFFFFFFull;
+
+// routes must hold key
+static size_t firstWithKey(const Route *routes, uint64_t key)
+{
+    size_t i = 0;
+    while (routes[i].rankKey() != key)
+    {
+        ++i;
+    }
+    return i;
+}
+
+static size_t selectBestScalar(const Route *routes, size_t n)
+{
+    size_t best = 0;
+    uint64_t bestKey = routes[0].rankKey();
+    for (size_t i = 1; i < n; ++i)
+    {
+        uint64_t key = routes[i].rankKey();
+        // strictly smaller, so ties keep the earlier route
+        bool better = key < bestKey;
+        best = better ? i : best;
+        bestKey = better ? key : bestKey;
+    }
+    return best;
+}
+
+#ifdef ROUTE_HAVE_AVX2
+/*
+Four routes per step: the minimum key over all lanes first, then the first
+route holding it. Keys stay below 2^63, so the signed 64-bit compare works.
+ */
+__attribute__((target("avx2"))) static size_t selectBestAvx2(const Route *routes, size_t n)
+{
+    const __m256i relBits = _mm256_set1_epi64x(static_cast<long long>(KEY_REL_BITS));
+    const __m256i keepBits = _mm256_set1_epi64x(static_cast<long long>(KEY_KEEP_BITS));
+    __m256i minKeys = _mm256_set1_epi64x(INT64_MAX);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(routes + i));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(routes + i + 2));
+        // high 8 bytes of routes i, i + 2, i + 1, i + 3, the order does not matter for the minimum
+        __m256i q = _mm256_unpackhi_epi64(lo, hi);
+        __m256i rel = _mm256_srli_epi64(_mm256_andnot_si256(q, relBits), 1);
+        __m256i keys = _mm256_or_si256(rel, _mm256_and_si256(q, keepBits));
+        __m256i greater = _mm256_cmpgt_epi64(minKeys, keys);
+        minKeys = _mm256_blendv_epi8(minKeys, keys, greater);
+    }
+
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), minKeys);
+    uint64_t best = lanes[0];
+    for (uint64_t lane : lanes)
+    {
+        best = lane < best ? lane : best;
+    }
+    for (; i < n; ++i)
+    {
+        uint64_t key = routes[i].rankKey();
+        best = key < best ? key : best;
+    }
+    return firstWithKey(routes, best);
+}
+#endif
+
+size_t Route::selectBest(const Route *routes, size_t n)
+{
+    static_assert(offsetof(Route, nextHopAsn) == 8 && offsetof(Route, meta) == 12,
+                  "selectBest reads next hop and meta as the high 8 bytes of a route");
+    if (n == 0)
+    {
+        return 0;
+    }
+#ifdef ROUTE_HAVE_AVX2
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2 && n >= 8)
+    {
+        return selectBestAvx2(routes, n);
+    }
+#endif
+    return selectBestScalar(routes, n);
+}
@@ -0,0 +1,78 @@
+#include "RunArena.h"
+
+using std::lock_guard;
+
+thread_local RunArena::CachedBuffer RunArena::cached;
+
+uint64_t RunArena::nextGeneration()
+{
+    static atomic<uint64_t> counter{1};
+    return counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+RunArena::ThreadBuffer &RunArena::threadBuffer()
+{
+    uint64_t current = generation.load(std::memory_order_acquire);
+    if (cached.generation == current)
+    {
+        return *cached.buffer;
+    }
+
+    /*
+    The thread switched arenas or this arena was reset, look its buffer up
+    (a thread id can come back after its thread exited, reusing the buffer
+    is fine since the old thread is gone).
+     */
+    lock_guard<mutex> guard(lock);
+    std::thread::id self = std::this_thread::get_id();
+    ThreadBuffer *buffer = nullptr;
+    for (unique_ptr<ThreadBuffer> &tb : buffers)
+    {
+        if (tb->owner == self)
+        {
+            buffer = tb.get();
+            break;
+        }
+    }
+    if (buffer == nullptr)
+    {
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = buffers.back().get();
+        buffer->owner = self;
+        buffer->buffer = std::make_unique<std::pmr::monotonic_buffer_resource>(INITIAL_BUFFER, std::pmr::new_delete_resource());
+    }
+    cached = {current, buffer};
+    return *buffer;
+}
+
+void *RunArena::do_allocate(size_t size, size_t alignment)
+{
+    ThreadBuffer &tb = threadBuffer();
+    tb.bytes += size;
+    return tb.buffer->allocate(size, alignment);
+}
+
+void RunArena::reset()
+{
+    lock_guard<mutex> guard(lock);
+    // a new generation makes every thread's cached buffer miss
+    generation.store(nextGeneration(), std::memory_order_release);
+    buffers.clear();
+}
+
+size_t RunArena::bytesAllocated()
+{
+    lock_guard<mutex> guard(lock);
+    size_t total = 0;
+    for (const unique_ptr<ThreadBuffer> &tb : buffers)
+    {
+        total += tb->bytes;
+    }
+    return total;
+}
+
+size_t RunArena::threadCount()
+{
+    lock_guard<mutex> guard(lock);
+    return buffers.size();
+}
@@ -0,0 +1,336 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ThreadPool.h"
+
+using std::cerr, std::endl, std::lock_guard, std::unique_lock;
+
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+ThreadPool::ThreadPool(unsigned numThreads, bool pinThreads)
+    : spinLimit(thread::hardware_concurrency() > 1 ? SPIN_LIMIT : 0)
+{
+    size_t workerCount = numThreads > 1 ? numThreads - 1 : 0;
+    runs = std::make_unique<ChunkRun[]>(workerCount + 1);
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        // worker 0 is the caller
+        workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+    if (pinThreads)
+    {
+        pinWorkers();
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        round.fetch_add(1, std::memory_order_release);
+    }
+    wake.notify_all();
+    for (thread &t : workers)
+    {
+        t.join();
+    }
+}
+
+void ThreadPool::pinWorkers()
+{
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        cerr << "Warning: could not read the CPU affinity mask, threads are not pinned" << endl;
+        return;
+    }
+    vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    if (cpus.empty())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpus[(i + 1) % cpus.size()], &one);
+        if (pthread_setaffinity_np(workers[i].native_handle(), sizeof(one), &one) == 0)
+        {
+            ++pinned;
+        }
+    }
+    if (pinned < workers.size())
+    {
+        cerr << "Warning: pinned " << pinned << " of " << workers.size() << " pool threads" << endl;
+    }
+#endif
+}
+
+void ThreadPool::workerLoop(size_t worker)
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        uint64_t current = round.load(std::memory_order_acquire);
+        for (uint32_t spin = 0; current == seen && spin < spinLimit; ++spin)
+        {
+            cpuRelax();
+            current = round.load(std::memory_order_acquire);
+        }
+        if (current == seen)
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [&]
+                      { current = round.load(std::memory_order_acquire);
+                        return current != seen; });
+        }
+        seen = current;
+
+        if (stopping)
+        {
+            return;
+        }
+
+        /*
+        The job cannot change before this worker checks in, so it is read
+        as written for this round. Workers without a run (fewer chunks than
+        threads) check in right away.
+         */
+        if (worker < job.parts)
+        {
+            drain(worker);
+        }
+        pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+bool ThreadPool::popFront(size_t participant, uint32_t &chunk)
+{
+    atomic<uint64_t> &range = runs[participant].range;
+    uint64_t curr = range.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint32_t next = static_cast<uint32_t>(curr >> 32);
+        uint32_t end = static_cast<uint32_t>(curr);
+        if (next >= end)
+        {
+            return false;
+        }
+        if (range.compare_exchange_weak(curr, (uint64_t(next + 1) << 32) | end, std::memory_order_acq_rel))
+        {
+            chunk = next;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::popBack(size_t participant, uint32_t &chunk)
+{
+    atomic<uint64_t> &range = runs[participant].range;
+    uint64_t curr = range.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint32_t next = static_cast<uint32_t>(curr >> 32);
+        uint32_t end = static_cast<uint32_t>(curr);
+        if (next >= end)
+        {
+            return false;
+        }
+        if (range.compare_exchange_weak(curr, (uint64_t(next) << 32) | (end - 1), std::memory_order_acq_rel))
+        {
+            chunk = end - 1;
+            return true;
+        }
+    }
+}
+
+uint64_t ThreadPool::clockNs() const
+{
+    if (cpuClock)
+    {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void ThreadPool::runChunk(size_t participant, uint32_t chunk)
+{
+    size_t begin = 0;
+    size_t end = 0;
+    if (job.bounds != nullptr)
+    {
+        begin = job.bounds[chunk];
+        end = job.bounds[chunk + 1];
+    }
+    else
+    {
+        begin = size_t(chunk) * job.chunk;
+        end = std::min(job.count, begin + job.chunk);
+    }
+
+    uint64_t start = clockNs();
+    job.call(job.task, begin, end);
+    uint64_t spent = clockNs() - start;
+
+    ChunkRun &own = runs[participant];
+    own.busyNs += spent;
+    own.roundBusyNs += spent;
+    own.roundMaxChunkNs = std::max(own.roundMaxChunkNs, spent);
+    ++own.chunks;
+}
+
+void ThreadPool::drain(size_t participant)
+{
+    uint32_t chunk;
+    while (popFront(participant, chunk))
+    {
+        runChunk(participant, chunk);
+    }
+
+    /*
+    Steal from the back so the owner keeps walking its run in order.
+    next and end only move towards each other, so a run found empty stays
+    empty and one pass finding nothing means the round's work is all taken.
+     */
+    size_t stolen = 0;
+    bool found = true;
+    while (found)
+    {
+        found = false;
+        for (size_t k = 1; k < job.parts; ++k)
+        {
+            size_t victim = (participant + k) % job.parts;
+            while (popBack(victim, chunk))
+            {
+                runChunk(participant, chunk);
+                ++stolen;
+                found = true;
+            }
+        }
+    }
+    if (stolen > 0)
+    {
+        steals.fetch_add(stolen, std::memory_order_relaxed);
+    }
+}
+
+void ThreadPool::run(size_t count, size_t chunk, const size_t *bounds, size_t chunks, TaskFn call, const void *task)
+{
+    for (size_t p = 0; p < size(); ++p)
+    {
+        runs[p].roundBusyNs = 0;
+        runs[p].roundMaxChunkNs = 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    size_t parts = std::min(size(), chunks);
+    if (parts <= 1 || chunks > UINT32_MAX)
+    {
+        // one chunk covering everything, on the caller
+        job = {call, task, count, std::max<size_t>(count, 1), nullptr, 1};
+        if (count > 0)
+        {
+            runChunk(0, 0);
+        }
+    }
+    else
+    {
+        job = {call, task, count, chunk, bounds, parts};
+        for (size_t p = 0; p < parts; ++p)
+        {
+            uint64_t first = chunks * p / parts;
+            uint64_t last = chunks * (p + 1) / parts;
+            runs[p].range.store((first << 32) | last, std::memory_order_relaxed);
+        }
+        pending.store(workers.size(), std::memory_order_relaxed);
+        {
+            // under the lock so a worker about to sleep cannot miss the bump
+            lock_guard<mutex> guard(lock);
+            round.fetch_add(1, std::memory_order_release);
+        }
+        wake.notify_all();
+
+        drain(0);
+
+        // barrier: wait for every worker to check in
+        for (uint32_t spin = 0; pending.load(std::memory_order_acquire) != 0; ++spin)
+        {
+            if (spin < spinLimit)
+            {
+                cpuRelax();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    uint64_t roundWallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    wallNs += roundWallNs;
+    last = RoundStats();
+    last.wallMs = roundWallNs / 1e6;
+    last.chunks = count > 0 ? std::max<size_t>(chunks, 1) : 0;
+    for (size_t p = 0; p < size(); ++p)
+    {
+        double busyMs = runs[p].roundBusyNs / 1e6;
+        last.workMs += busyMs;
+        last.criticalMs = std::max(last.criticalMs, busyMs);
+        last.maxChunkMs = std::max(last.maxChunkMs, runs[p].roundMaxChunkNs / 1e6);
+    }
+}
+
+vector<ThreadStats> ThreadPool::stats() const
+{
+    vector<ThreadStats> result(size());
+    for (size_t p = 0; p < size(); ++p)
+    {
+        result[p].busyMs = runs[p].busyNs / 1e6;
+        // with the CPU clock busy can exceed the wall time spent in the calls, idle stays >= 0
+        result[p].idleMs = std::max(0.0, (double(wallNs) - double(runs[p].busyNs)) / 1e6);
+        result[p].chunks = runs[p].chunks;
+    }
+    return result;
+}
+
+void ThreadPool::resetStats()
+{
+    wallNs = 0;
+    for (size_t p = 0; p < size(); ++p)
+    {
+        runs[p].busyNs = 0;
+        runs[p].chunks = 0;
+    }
+    last = RoundStats();
+}
@@ -0,0 +1,36 @@
+#include "Topology.h"
+
+static void fillCsr(CsrAdjacency &csr, const deque<AS> &nodes,
+                    const unordered_map<int, AS *> &asMap,
+                    const vector<int> &(AS::*neighborsOf)() const)
+{
+    csr.offsets.assign(nodes.size() + 1, 0);
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        csr.offsets[i + 1] = csr.offsets[i] + (nodes[i].*neighborsOf)().size();
+    }
+
+    csr.neighbors.resize(csr.offsets.back());
+    size_t pos = 0;
+    for (const AS &as : nodes)
+    {
+        // keep the original neighbor order so propagation visits edges in the same order
+        for (int asn : (as.*neighborsOf)())
+        {
+            csr.neighbors[pos++] = asMap.at(asn)->getIndex();
+        }
+    }
+}
+
+void Topology::build(const deque<AS> &nodes, const unordered_map<int, AS *> &asMap)
+{
+    asns.resize(nodes.size());
+    for (const AS &as : nodes)
+    {
+        asns[as.getIndex()] = as.getAsn();
+    }
+
+    fillCsr(providers, nodes, asMap, &AS::getProviders);
+    fillCsr(customers, nodes, asMap, &AS::getCustomers);
+    fillCsr(peers, nodes, asMap, &AS::getPeers);
+}
@@ -0,0 +1,42 @@
+#include <iostream>
+#include <string>
+
+#include "AsGraph.h"
+
+using std::cout, std::cerr, std::endl, std::string;
+
+/*
+Converts a CAIDA as-rel2 text file (plus an optional ROV deployment list)
+into a binary graph snapshot that main and the benchmarks can load directly.
+
+usage: convert_snapshot <as-rel2 file> <output snapshot> [rov_asns.csv]
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "usage: " << argv[0] << " <as-rel2 file> <output snapshot> [rov_asns.csv]" << endl;
+        return 1;
+    }
+    string inputFile = argv[1];
+    string outputFile = argv[2];
+
+    AsGraph graph;
+    if (argc > 3 && graph.loadROVDeployment(argv[3]) != 0)
+    {
+        return 1;
+    }
+    if (graph.buildGraph(inputFile) != 0)
+    {
+        return 1;
+    }
+    if (graph.saveSnapshot(outputFile) != 0)
+    {
+        cerr << "Failed to write snapshot " << outputFile << endl;
+        return 1;
+    }
+
+    cout << "Wrote " << graph.getAsMap().size() << " ASes in "
+         << graph.getFlattenedGraph().size() << " ranks to " << outputFile << endl;
+    return 0;
+}
@@ -10,6 +10,7 @@
 
 #include "AS.h"
 #include "AsGraph.h"
+#include "Utils.h"
 
 namespace fs = std::filesystem;
 
@@ -28,26 +29,63 @@ int main()
     // building the graph
     AsGraph graph;
 
-    int err = graph.loadROVDeployment(pathPrefix + test + "/rov_asns.csv");
-    if (err != 0)
+    /*
+    A snapshot made by convert_snapshot already holds the edges, ROV
+    deployment and ranks. It is only used while it is newer than both files
+    it was made from, otherwise those are parsed again.
+     */
+    string snapshotFile = pathPrefix + test + "/graph.snap";
+    string rovFile = pathPrefix + test + "/rov_asns.csv";
+    string graphFile = pathPrefix + test + "/CAIDAASGraphCollector_2025.10.15.txt";
+    bool useSnapshot = fs::exists(snapshotFile);
+    std::error_code ec;
+    for (const string &source : {rovFile, graphFile})
     {
-        cout << "Error loading ROV deployment file." << endl;
-        return -1;
+        if (useSnapshot && fs::exists(source) && fs::last_write_time(source, ec) > fs::last_write_time(snapshotFile, ec))
+        {
+            cout << source << " is newer than " << snapshotFile << ", ignoring the snapshot." << endl;
+            useSnapshot = false;
+        }
     }
 
-    err = graph.buildGraph(pathPrefix + test + "/CAIDAASGraphCollector_2025.10.15.txt");
-    if (err != 0)
+    if (useSnapshot)
     {
-        cout << "Error building AS graph." << endl;
-        return -1;
+        cout << "Loading graph snapshot " << snapshotFile << endl;
+        if (graph.loadSnapshot(snapshotFile) != 0)
+        {
+            cout << "Error loading graph snapshot." << endl;
+            return -1;
+        }
     }
-    graph.flattenGraph();
-
-    bool hasCycle = graph.hasCycle();
-    if (hasCycle)
+    else
     {
-        cerr << "Cannot have cycle!!!\n Something with code is incorrect." << endl;
-        return -1;
+        cout << "Parsing " << graphFile << " and " << rovFile << endl;
+        int err = graph.loadROVDeployment(rovFile);
+        if (err != 0)
+        {
+            cout << "Error loading ROV deployment file." << endl;
+            return -1;
+        }
+
+        err = graph.buildGraph(graphFile);
+        if (err != 0)
+        {
+            cout << "Error building AS graph." << endl;
+            return -1;
+        }
+        const IngestStats &stats = graph.getIngestStats();
+        if (stats.duplicates > 0 || stats.conflicts > 0)
+        {
+            cout << "Collapsed " << stats.duplicates << " duplicate and " << stats.conflicts
+                 << " conflicting relationship lines out of " << stats.lines << "." << endl;
+        }
+        // ranking also detects provider->customer cycles
+        if (!graph.flattenGraph())
+        {
+            cerr << "Cannot have cycle!!!\n Something with code is incorrect." << endl;
+            cerr << "Cycle: " << Utils::join(graph.getCycle(), " -> ") << endl;
+            return -1;
+        }
     }
 
     graph.processInitialAnnouncements(pathPrefix + test + "/anns.csv");
@@ -80,28 +118,31 @@ int main()
 
     outfile << "asn,prefix,as_path" << std::endl;
     const auto &asMap = graph.getAsMap();
+    const PathPool &pathPool = graph.getPathPool();
     for (const auto &pair : asMap)
     {
         int asn = pair.first;
-        AS *as = pair.second.get();
+        AS *as = pair.second;
         const auto &localRib = as->getPolicy().getlocalRib();
         for (const auto &entry : localRib)
         {
             const string &prefix = entry.first;
             const Announcement &ann = entry.second;
-            const vector<int> &currPath = ann.getAsPath();
+            PathHandle currPath = ann.getPathHandle();
 
+            // walk the shared path nodes instead of building a vector per route
             ostringstream asPath;
             asPath << "\"(";
-            for (size_t i = 0; i < currPath.size(); ++i)
-            {
-                asPath << currPath[i];
-                if (i < currPath.size() - 1)
+            bool firstHop = true;
+            pathPool.walk(currPath, [&](int hop)
+                          {
+                if (!firstHop)
                 {
                     asPath << ", ";
                 }
-            }
-            if (currPath.size() == 1)
+                asPath << hop;
+                firstHop = false; });
+            if (pathPool.length(currPath) == 1)
             {
                 asPath << ",";
             }
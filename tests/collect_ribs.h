@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "AsGraph.h"
+
+// path, next hop and relationship of one RIB entry
+using RibRoute = std::tuple<std::vector<int>, int, Relationship>;
+
+// asn -> prefix -> entry, what propagation tests compare between runs
+using RibDump = std::map<int, std::map<std::string, RibRoute>>;
+
+// shard count that tells the tests' propagate helpers to run up, across and down instead of propagateByPrefix
+static constexpr size_t RANK_BY_RANK = SIZE_MAX;
+
+// every route in every RIB of graph
+inline RibDump collectRibs(const AsGraph &graph)
+{
+    RibDump ribs;
+    for (const auto &[asn, as] : graph.getAsMap())
+    {
+        for (const auto &entry : as->getPolicy().getlocalRib())
+        {
+            ribs[asn][entry.first] = {entry.second.getAsPath(), entry.second.getNextHopAsn(),
+                                      entry.second.getRelationship()};
+        }
+    }
+    return ribs;
+}
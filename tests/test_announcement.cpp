@@ -1,8 +1,11 @@
 #include <gtest/gtest.h>
 #include "Announcement.h"
 #include "Relationships.h"
+#include "BGP.h"
 #include <vector>
+#include <thread>
 #include <string>
+#include <random>
 
 class AnnouncementTest : public ::testing::Test
 {
@@ -232,3 +235,198 @@ TEST_F(AnnouncementTest, MultipleSetters)
     EXPECT_EQ(600, ann.getAsPath()[0]);
     EXPECT_EQ(800, ann.getAsPath()[2]);
 }
+
+// ==================== PREFIX INTERNING TESTS ====================
+
+TEST_F(AnnouncementTest, SamePrefixSharesId)
+{
+    Announcement ann1("198.18.0.0/15", {100}, 100, Relationship::CUSTOMER);
+    Announcement ann2(std::string("198.18.0.0/15"), {200}, 200, Relationship::PEER);
+    Announcement ann3("198.19.0.0/16", {300}, 300, Relationship::PEER);
+
+    EXPECT_EQ(ann1.getPrefixId(), ann2.getPrefixId());
+    EXPECT_NE(ann1.getPrefixId(), ann3.getPrefixId());
+    EXPECT_EQ(ann1.getPrefixId(), PrefixTable::global().find("198.18.0.0/15"));
+    EXPECT_EQ("198.19.0.0/16", PrefixTable::global().get(ann3.getPrefixId()));
+
+    // built from an id, the prefix string is looked up
+    Announcement fromId(ann3.getPrefixId(), {400}, 400, Relationship::PROVIDER);
+    EXPECT_EQ("198.19.0.0/16", fromId.getPrefix());
+}
+
+// ==================== PATH POOL TESTS ====================
+
+TEST_F(AnnouncementTest, EqualPathsShareHandle)
+{
+    Announcement ann1("10.0.0.0/8", {100, 200, 300}, 100, Relationship::CUSTOMER);
+    Announcement ann2("172.16.0.0/12", {100, 200, 300}, 100, Relationship::PEER);
+    Announcement ann3("10.0.0.0/8", {100, 200}, 100, Relationship::PEER);
+
+    // built on the same thread, equal paths get the same handle
+    EXPECT_EQ(ann1.getPathHandle(), ann2.getPathHandle());
+    EXPECT_NE(ann1.getPathHandle(), ann3.getPathHandle());
+    EXPECT_EQ(3, ann1.getPathLength());
+
+    // prepending reuses the node that already holds 100 -> 200 -> 300
+    Announcement shorter("10.0.0.0/8", {200, 300}, 200, Relationship::PROVIDER);
+    size_t nodes = PathPool::global().size();
+    shorter.prependAsn(100);
+    EXPECT_EQ(nodes, PathPool::global().size());
+    EXPECT_EQ(ann1.getPathHandle(), shorter.getPathHandle());
+    EXPECT_EQ(std::vector<int>({100, 200, 300}), shorter.getAsPath());
+}
+
+TEST_F(AnnouncementTest, MutatedPathIsReinterned)
+{
+    Announcement ann("10.0.0.0/8", {100, 200}, 100, Relationship::PEER);
+    ann.getAsPath().insert(ann.getAsPath().begin(), 50);
+
+    EXPECT_EQ(3, ann.getPathLength());
+    EXPECT_EQ(PathPool::global().intern({50, 100, 200}), ann.getPathHandle());
+
+    // copies carry the mutated path
+    Announcement copy(ann);
+    EXPECT_EQ(std::vector<int>({50, 100, 200}), copy.getAsPath());
+    copy.prependAsn(25);
+    EXPECT_EQ(std::vector<int>({25, 50, 100, 200}), copy.getAsPath());
+    EXPECT_EQ(3, ann.getPathLength());
+}
+
+TEST_F(AnnouncementTest, PoliciesReinternForeignPaths)
+{
+    // a route whose path lives in a private pool, like one read out of a graph
+    PathPool own;
+    Route route(0, own.intern({200, 300}), 200, Relationship::CUSTOMER, false, own);
+    Announcement ann(route, own);
+    EXPECT_EQ(&own, &ann.getPathPool());
+    EXPECT_EQ(std::vector<int>({200, 300}), ann.getAsPath());
+
+    // a policy on the global pool takes it in with its own handle
+    BGP bgp(100);
+    bgp.enqueueAnnouncement(ann);
+    bgp.processAnnouncements();
+    Announcement stored = bgp.getlocalRib().at(ann.getPrefix());
+    EXPECT_EQ(&PathPool::global(), &stored.getPathPool());
+    EXPECT_EQ(std::vector<int>({100, 200, 300}), stored.getAsPath());
+    EXPECT_EQ(3, stored.getPathLength());
+}
+
+TEST_F(AnnouncementTest, ConcurrentPrependsKeepPathsApart)
+{
+    PathPool pool;
+    std::vector<std::vector<PathHandle>> handles(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < handles.size(); ++t)
+    {
+        threads.emplace_back([&pool, &handles, t]
+                             {
+            // every thread builds the same paths, on top of a shared suffix
+            for (int i = 0; i < 5000; ++i)
+            {
+                handles[t].push_back(pool.intern({i, i + 1, 7}));
+            } });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    for (const auto &perThread : handles)
+    {
+        for (int i = 0; i < 5000; ++i)
+        {
+            ASSERT_EQ(std::vector<int>({i, i + 1, 7}), pool.toVector(perThread[i]));
+        }
+        // interning again on one thread hands back the same nodes
+        EXPECT_EQ(pool.intern({42, 43, 7}), pool.intern({42, 43, 7}));
+    }
+}
+
+// ==================== PACKED ROUTE TESTS ====================
+
+TEST_F(AnnouncementTest, RouteRoundTripsPackedFields)
+{
+    Relationship rels[] = {Relationship::ORIGIN, Relationship::CUSTOMER, Relationship::PEER, Relationship::PROVIDER};
+    for (Relationship rel : rels)
+    {
+        for (bool rovInvalid : {false, true})
+        {
+            Announcement ann("10.0.0.0/8", {100, 200, 300}, 65000, rel, rovInvalid);
+            Route route = ann.getRoute();
+
+            EXPECT_EQ(rel, route.getRelationship());
+            EXPECT_EQ(rovInvalid, route.isRovInvalid());
+            EXPECT_EQ(3, route.getPathLength());
+            EXPECT_EQ(65000, route.getNextHopAsn());
+            EXPECT_EQ(ann.getPrefixId(), route.getPrefixId());
+
+            // the façade built back from the route sees the same announcement
+            Announcement back(route);
+            EXPECT_EQ(rel, back.getRelationship());
+            EXPECT_EQ(rovInvalid, back.isRovInvalid());
+            EXPECT_EQ(std::vector<int>({100, 200, 300}), back.getAsPath());
+        }
+    }
+}
+
+TEST_F(AnnouncementTest, RouteForwardAndPrepend)
+{
+    Route route = Announcement("10.0.0.0/8", {100}, 100, Relationship::ORIGIN, true).getRoute();
+
+    Route sent = route.forwarded(200, Relationship::CUSTOMER);
+    EXPECT_EQ(Relationship::CUSTOMER, sent.getRelationship());
+    EXPECT_EQ(200, sent.getNextHopAsn());
+    EXPECT_TRUE(sent.isRovInvalid());
+    EXPECT_EQ(route.getPath(), sent.getPath());
+
+    sent.prependAsn(300, PathPool::global());
+    EXPECT_EQ(2, sent.getPathLength());
+    EXPECT_EQ(std::vector<int>({300, 100}), PathPool::global().toVector(sent.getPath()));
+    EXPECT_EQ(Relationship::CUSTOMER, sent.getRelationship());
+    EXPECT_TRUE(sent.isRovInvalid());
+}
+
+TEST_F(AnnouncementTest, RankKeyMatchesChooseBestOrder)
+{
+    // every relationship beats the ones below it regardless of length and next hop
+    Route provider = Announcement("10.0.0.0/8", {1}, 1, Relationship::PROVIDER).getRoute();
+    Route peer = Announcement("10.0.0.0/8", {9, 9, 9, 9}, 900, Relationship::PEER).getRoute();
+    Route customer = Announcement("10.0.0.0/8", {9, 9, 9, 9, 9}, 999, Relationship::CUSTOMER).getRoute();
+    Route origin = Announcement("10.0.0.0/8", {9, 9, 9, 9, 9, 9}, 999, Relationship::ORIGIN).getRoute();
+    EXPECT_LT(peer.rankKey(), provider.rankKey());
+    EXPECT_LT(customer.rankKey(), peer.rankKey());
+    EXPECT_LT(origin.rankKey(), customer.rankKey());
+
+    Route shortPath = Announcement("10.0.0.0/8", {7}, 700, Relationship::PEER).getRoute();
+    Route lowHop = Announcement("10.0.0.0/8", {7}, 100, Relationship::PEER).getRoute();
+    EXPECT_LT(shortPath.rankKey(), peer.rankKey());
+    EXPECT_LT(lowHop.rankKey(), shortPath.rankKey());
+}
+
+TEST_F(AnnouncementTest, SelectBestMatchesSequentialFold)
+{
+    std::mt19937 rng(7);
+    Relationship rels[] = {Relationship::PROVIDER, Relationship::PEER, Relationship::CUSTOMER, Relationship::ORIGIN};
+
+    // small value ranges so ties on every criterion are common
+    for (size_t n = 0; n <= 40; ++n)
+    {
+        for (int trial = 0; trial < 20; ++trial)
+        {
+            std::vector<Route> routes;
+            for (size_t i = 0; i < n; ++i)
+            {
+                std::vector<int> path(1 + rng() % 3, static_cast<int>(i));
+                routes.push_back(Announcement("10.0.0.0/8", path, 100 + rng() % 3, rels[rng() % 4]).getRoute());
+            }
+
+            const Route *best = nullptr;
+            for (const Route &r : routes)
+            {
+                best = Route::chooseBest(best, &r);
+            }
+            size_t expected = best == nullptr ? 0 : static_cast<size_t>(best - routes.data());
+            EXPECT_EQ(expected, Route::selectBest(routes.data(), routes.size())) << "n = " << n;
+        }
+    }
+}
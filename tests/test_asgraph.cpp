@@ -2,10 +2,12 @@
 #include "AsGraph.h"
 #include "Utils.h"
 #include "Relationships.h"
+#include "GraphSnapshot.h"
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <algorithm>
+#include <map>
 
 class AsGraphTest : public ::testing::Test
 {
@@ -116,27 +118,27 @@ TEST_F(AsGraphTest, ASRelationships)
     const auto &asMap = graph->getAsMap();
 
     // Ensure nodes have correct relationships
-    const AS *as1 = asMap.at(1).get();
+    const AS *as1 = asMap.at(1);
     EXPECT_EQ(1, as1->getPeers().size());
     EXPECT_EQ(0, as1->getProviders().size());
     EXPECT_EQ(0, as1->getCustomers().size());
     EXPECT_TRUE(contains(as1->getPeers(), 2));
 
-    const AS *as2 = asMap.at(2).get();
+    const AS *as2 = asMap.at(2);
     EXPECT_EQ(1, as2->getPeers().size());
     EXPECT_EQ(0, as2->getProviders().size());
     EXPECT_EQ(1, as2->getCustomers().size());
     EXPECT_TRUE(contains(as2->getPeers(), 1));
     EXPECT_TRUE(contains(as2->getCustomers(), 3));
 
-    const AS *as3 = asMap.at(3).get();
+    const AS *as3 = asMap.at(3);
     EXPECT_EQ(0, as3->getPeers().size());
     EXPECT_EQ(2, as3->getProviders().size());
     EXPECT_EQ(0, as3->getCustomers().size());
     EXPECT_TRUE(contains(as3->getProviders(), 2));
     EXPECT_TRUE(contains(as3->getProviders(), 4));
 
-    const AS *as4 = asMap.at(4).get();
+    const AS *as4 = asMap.at(4);
     EXPECT_EQ(0, as4->getPeers().size());
     EXPECT_EQ(0, as4->getProviders().size());
     EXPECT_EQ(1, as4->getCustomers().size());
@@ -180,8 +182,8 @@ TEST_F(AsGraphTest, PeerRelationships)
     EXPECT_TRUE(as200_has_as100_peer);
 
     // Check AS object peer lists
-    const AS *as100 = asMap.at(100).get();
-    const AS *as200 = asMap.at(200).get();
+    const AS *as100 = asMap.at(100);
+    const AS *as200 = asMap.at(200);
     EXPECT_TRUE(contains(as100->getPeers(), 200));
     EXPECT_TRUE(contains(as200->getPeers(), 100));
 }
@@ -200,6 +202,89 @@ TEST_F(AsGraphTest, CycleDetection)
     EXPECT_TRUE(cycleGraph.nodeHasCycle(3));
 }
 
+// Test that the offending cycle is reported, also from flattenGraph
+TEST_F(AsGraphTest, CycleReporting)
+{
+    graph->buildGraph("test_simple.txt");
+    EXPECT_TRUE(graph->findCycle().empty());
+    EXPECT_TRUE(graph->flattenGraph());
+    EXPECT_TRUE(graph->getCycle().empty());
+
+    AsGraph cycleGraph;
+    cycleGraph.buildGraph("test_cycle.txt");
+
+    std::vector<int> found = cycleGraph.findCycle();
+    ASSERT_EQ(4, found.size());
+    EXPECT_EQ(found.front(), found.back());
+    std::vector<int> members(found.begin(), found.end() - 1);
+    std::sort(members.begin(), members.end());
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), members);
+
+    // every consecutive pair must be a provider->customer edge
+    const auto &asMap = cycleGraph.getAsMap();
+    for (size_t i = 0; i + 1 < found.size(); ++i)
+    {
+        EXPECT_TRUE(contains(asMap.at(found[i])->getCustomers(), found[i + 1]));
+    }
+
+    EXPECT_FALSE(cycleGraph.flattenGraph());
+    EXPECT_EQ(4, cycleGraph.getCycle().size());
+    EXPECT_TRUE(cycleGraph.getFlattenedGraph().empty());
+}
+
+// Test that deep provider chains do not recurse once per node
+TEST_F(AsGraphTest, DeepChainNoRecursion)
+{
+    std::ofstream chain("test_chain.txt");
+    const int depth = 200000;
+    for (int i = 1; i < depth; ++i)
+    {
+        chain << i << "|" << i + 1 << "|-1|bgp\n";
+    }
+    chain.close();
+
+    AsGraph chainGraph;
+    chainGraph.buildGraph("test_chain.txt");
+    std::filesystem::remove("test_chain.txt");
+
+    EXPECT_FALSE(chainGraph.hasCycle());
+    ASSERT_TRUE(chainGraph.flattenGraph());
+    const auto &ranks = chainGraph.getFlattenedGraph();
+    ASSERT_EQ(depth, ranks.size());
+    EXPECT_EQ(std::vector<int>({depth}), ranks.front());
+    EXPECT_EQ(std::vector<int>({1}), ranks.back());
+}
+
+// Test that every AS sits exactly one rank above its highest customer
+TEST_F(AsGraphTest, FlattenRanksAreTight)
+{
+    // 1 and 2 are multihomed providers of 3, 1 also reaches 3 through 4 -> 5
+    std::ofstream diamond("test_diamond.txt");
+    diamond << "1|3|-1|bgp\n";
+    diamond << "2|3|-1|bgp\n";
+    diamond << "1|4|-1|bgp\n";
+    diamond << "4|5|-1|bgp\n";
+    diamond << "5|3|-1|bgp\n";
+    diamond << "2|6|0|bgp\n";
+    diamond.close();
+
+    AsGraph diamondGraph;
+    diamondGraph.buildGraph("test_diamond.txt");
+    std::filesystem::remove("test_diamond.txt");
+    ASSERT_TRUE(diamondGraph.flattenGraph());
+
+    const auto &ranks = diamondGraph.getFlattenedGraph();
+    ASSERT_EQ(4, ranks.size());
+    EXPECT_EQ(std::vector<int>({3, 6}), ranks[0]);
+    EXPECT_EQ(std::vector<int>({2, 5}), ranks[1]);
+    EXPECT_EQ(std::vector<int>({4}), ranks[2]);
+    EXPECT_EQ(std::vector<int>({1}), ranks[3]);
+
+    // ranks are one contiguous buffer
+    EXPECT_EQ(6, ranks.getItems().size());
+    EXPECT_EQ(std::vector<uint32_t>({0, 2, 4, 5, 6}), ranks.getOffsets());
+}
+
 // Test empty graph
 TEST_F(AsGraphTest, EmptyGraph)
 {
@@ -221,9 +306,9 @@ TEST_F(AsGraphTest, ComplexGraph)
     const auto &asMap = graph->getAsMap();
     EXPECT_EQ(5, asMap.size());
 
-    const AS *as100 = asMap.at(100).get();
-    const AS *as200 = asMap.at(200).get();
-    const AS *as300 = asMap.at(300).get();
+    const AS *as100 = asMap.at(100);
+    const AS *as200 = asMap.at(200);
+    const AS *as300 = asMap.at(300);
 
     EXPECT_TRUE(contains(as100->getPeers(), 200));
     EXPECT_TRUE(contains(as200->getPeers(), 100));
@@ -233,14 +318,354 @@ TEST_F(AsGraphTest, ComplexGraph)
     // Test provider-customer relationships
     EXPECT_TRUE(contains(as300->getCustomers(), 400));
 
-    const AS *as400 = asMap.at(400).get();
+    const AS *as400 = asMap.at(400);
     EXPECT_TRUE(contains(as400->getProviders(), 300));
     EXPECT_TRUE(contains(as400->getProviders(), 500));
 
-    const AS *as500 = asMap.at(500).get();
+    const AS *as500 = asMap.at(500);
     EXPECT_TRUE(contains(as500->getCustomers(), 400));
 }
 
+// Test that the CSR topology mirrors the AS neighbor vectors
+TEST_F(AsGraphTest, TopologyMatchesNeighborVectors)
+{
+    graph->buildGraph("test_peers.txt");
+
+    const Topology &topology = graph->getTopology();
+    const auto &asMap = graph->getAsMap();
+    ASSERT_EQ(asMap.size(), topology.size());
+
+    auto toAsns = [&topology](NeighborRange range)
+    {
+        std::vector<int> asns;
+        for (uint32_t idx : range)
+        {
+            asns.push_back(topology.asnOf(idx));
+        }
+        return asns;
+    };
+
+    for (const auto &pair : asMap)
+    {
+        long idx = graph->indexOf(pair.first);
+        ASSERT_GE(idx, 0);
+        EXPECT_EQ(pair.second->getProviders(), toAsns(topology.getProviders(idx)));
+        EXPECT_EQ(pair.second->getCustomers(), toAsns(topology.getCustomers(idx)));
+        EXPECT_EQ(pair.second->getPeers(), toAsns(topology.getPeers(idx)));
+    }
+    EXPECT_EQ(-1, graph->indexOf(12345));
+}
+
+// Test that parallel ingestion builds the same graph as the serial path
+TEST_F(AsGraphTest, ParallelBuildMatchesSerial)
+{
+    AsGraph parallelGraph;
+    graph->buildGraph("test_peers.txt");
+    parallelGraph.buildGraph("test_peers.txt", 3);
+
+    const auto &serialMap = graph->getAsMap();
+    const auto &parallelMap = parallelGraph.getAsMap();
+    ASSERT_EQ(serialMap.size(), parallelMap.size());
+    EXPECT_EQ(graph->getAdjacencyList(), parallelGraph.getAdjacencyList());
+
+    for (const auto &pair : serialMap)
+    {
+        ASSERT_TRUE(parallelMap.find(pair.first) != parallelMap.end());
+        const AS *serialAs = pair.second;
+        const AS *parallelAs = parallelMap.at(pair.first);
+        EXPECT_EQ(serialAs->getProviders(), parallelAs->getProviders());
+        EXPECT_EQ(serialAs->getCustomers(), parallelAs->getCustomers());
+        EXPECT_EQ(serialAs->getPeers(), parallelAs->getPeers());
+    }
+
+    AsGraph missingGraph;
+    EXPECT_EQ(-1, missingGraph.buildGraph("nonexistent_file.txt", 4));
+}
+
+// Test that a snapshot reproduces the graph, ranks and ROV deployment
+TEST_F(AsGraphTest, SnapshotRoundTrip)
+{
+    std::ofstream rov("test_snapshot_rov.csv");
+    rov << "300\n";
+    rov.close();
+
+    graph->loadROVDeployment("test_snapshot_rov.csv");
+    graph->buildGraph("test_peers.txt");
+    graph->flattenGraph();
+    ASSERT_EQ(0, graph->saveSnapshot("test_graph.snap"));
+
+    AsGraph loaded;
+    ASSERT_EQ(0, loaded.loadSnapshot("test_graph.snap"));
+    std::filesystem::remove("test_snapshot_rov.csv");
+    std::filesystem::remove("test_graph.snap");
+
+    const auto &asMap = graph->getAsMap();
+    const auto &loadedMap = loaded.getAsMap();
+    ASSERT_EQ(asMap.size(), loadedMap.size());
+    for (const auto &pair : asMap)
+    {
+        const AS *as = pair.second;
+        const AS *loadedAs = loadedMap.at(pair.first);
+
+        auto sorted = [](std::vector<int> v)
+        {
+            std::sort(v.begin(), v.end());
+            return v;
+        };
+        EXPECT_EQ(sorted(as->getProviders()), sorted(loadedAs->getProviders()));
+        EXPECT_EQ(sorted(as->getCustomers()), sorted(loadedAs->getCustomers()));
+        EXPECT_EQ(sorted(as->getPeers()), sorted(loadedAs->getPeers()));
+    }
+    EXPECT_EQ(graph->getFlattenedGraph(), loaded.getFlattenedGraph());
+
+    // AS300 deploys ROV, so it must drop ROV-invalid announcements after loading
+    Policy &rovPolicy = loadedMap.at(300)->getPolicy();
+    rovPolicy.enqueueAnnouncement(Announcement("10.0.0.0/8", {400}, 400, Relationship::CUSTOMER, true));
+    rovPolicy.processAnnouncements();
+    EXPECT_EQ(0, rovPolicy.getlocalRib().size());
+
+    Policy &bgpPolicy = loadedMap.at(200)->getPolicy();
+    bgpPolicy.enqueueAnnouncement(Announcement("10.0.0.0/8", {300}, 300, Relationship::PEER, true));
+    bgpPolicy.processAnnouncements();
+    EXPECT_EQ(1, bgpPolicy.getlocalRib().size());
+}
+
+// Test that snapshots refuse cyclic graphs and bad input files
+TEST_F(AsGraphTest, SnapshotRejectsInvalidInput)
+{
+    AsGraph cycleGraph;
+    cycleGraph.buildGraph("test_cycle.txt");
+    EXPECT_EQ(-1, cycleGraph.saveSnapshot("test_cycle.snap"));
+    std::filesystem::remove("test_cycle.snap");
+
+    // a text file is not a snapshot
+    EXPECT_EQ(-1, graph->loadSnapshot("test_simple.txt"));
+    EXPECT_EQ(-1, graph->loadSnapshot("nonexistent_file.snap"));
+    EXPECT_EQ(0, graph->getAsMap().size());
+
+    // corrupt contents are caught before the graph is touched
+    AsGraph source;
+    source.buildGraph("test_peers.txt");
+    ASSERT_EQ(0, source.saveSnapshot("test_corrupt.snap"));
+    // overwrites element pos of a 32-bit section, returns what was there
+    auto corrupted = [](SnapshotSectionId id, size_t pos, uint32_t value)
+    {
+        std::fstream snap("test_corrupt.snap", std::ios::in | std::ios::out | std::ios::binary);
+        SnapshotHeader header;
+        snap.read(reinterpret_cast<char *>(&header), sizeof(header));
+        uint64_t at = header.sections[id].offset + pos * sizeof(uint32_t);
+        uint32_t old;
+        snap.seekg(at);
+        snap.read(reinterpret_cast<char *>(&old), sizeof(old));
+        snap.seekp(at);
+        snap.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        return old;
+    };
+
+    uint32_t neighbor = corrupted(SNAP_CUSTOMER_NEIGHBORS, 0, 1000);
+    AsGraph badNeighbor;
+    EXPECT_EQ(-1, badNeighbor.loadSnapshot("test_corrupt.snap"));
+    EXPECT_EQ(0, badNeighbor.getAsMap().size());
+    EXPECT_EQ(0, badNeighbor.getTopology().size());
+    corrupted(SNAP_CUSTOMER_NEIGHBORS, 0, neighbor);
+
+    // AS400's provider swapped for another AS, every degree stays the same
+    uint32_t provider = corrupted(SNAP_PROVIDER_NEIGHBORS, 0, 0);
+    corrupted(SNAP_PROVIDER_NEIGHBORS, 0, (provider + 1) % 4);
+    AsGraph badProvider;
+    EXPECT_EQ(-1, badProvider.loadSnapshot("test_corrupt.snap"));
+    EXPECT_EQ(0, badProvider.getAsMap().size());
+    EXPECT_EQ(0, badProvider.getTopology().size());
+    corrupted(SNAP_PROVIDER_NEIGHBORS, 0, provider);
+
+    // the first ranked AS listed twice
+    uint32_t first = corrupted(SNAP_RANK_INDICES, 0, 0);
+    corrupted(SNAP_RANK_INDICES, 0, first);
+    corrupted(SNAP_RANK_INDICES, 1, first);
+    AsGraph badRanks;
+    EXPECT_EQ(-1, badRanks.loadSnapshot("test_corrupt.snap"));
+    EXPECT_EQ(0, badRanks.getAsMap().size());
+    EXPECT_TRUE(badRanks.getFlattenedGraph().empty());
+    std::filesystem::remove("test_corrupt.snap");
+}
+
+
+// Test that repeated relationships are stored once
+TEST_F(AsGraphTest, DuplicateEdgesCollapsed)
+{
+    std::ofstream dup("test_duplicates.txt");
+    dup << "1|2|-1|bgp\n";
+    dup << "1|2|-1|mlp\n"; // same relationship from another source
+    dup << "3|4|0|bgp\n";
+    dup << "4|3|0|bgp\n"; // peer listed from the other side
+    dup << "1|3|-1|bgp\n";
+    dup.close();
+
+    graph->buildGraph("test_duplicates.txt");
+    std::filesystem::remove("test_duplicates.txt");
+
+    const auto &asMap = graph->getAsMap();
+    EXPECT_EQ(std::vector<int>({2, 3}), asMap.at(1)->getCustomers());
+    EXPECT_EQ(std::vector<int>({1}), asMap.at(2)->getProviders());
+    EXPECT_EQ(std::vector<int>({4}), asMap.at(3)->getPeers());
+    EXPECT_EQ(std::vector<int>({3}), asMap.at(4)->getPeers());
+    EXPECT_EQ(2, graph->getAdjacencyList().at(1).size());
+    EXPECT_EQ(1, graph->getAdjacencyList().at(3).size());
+    EXPECT_EQ(1, graph->getAdjacencyList().at(4).size());
+
+    const IngestStats &stats = graph->getIngestStats();
+    EXPECT_EQ(5, stats.lines);
+    EXPECT_EQ(2, stats.duplicates);
+    EXPECT_EQ(0, stats.conflicts);
+}
+
+// Test each rule for lines that disagree about the same pair
+TEST_F(AsGraphTest, ConflictingEdgesResolved)
+{
+    std::ofstream conflict("test_conflicts.txt");
+    conflict << "1|2|-1|bgp\n";
+    conflict << "2|1|-1|bgp\n"; // reversed direction
+    conflict << "3|4|0|bgp\n";
+    conflict << "3|4|-1|bgp\n"; // peer vs provider
+    conflict << "3|4|-1|bgp\n";
+    conflict.close();
+
+    AsGraph first;
+    first.buildGraph("test_conflicts.txt");
+    EXPECT_EQ(std::vector<int>({2}), first.getAsMap().at(1)->getCustomers());
+    EXPECT_TRUE(first.getAsMap().at(1)->getProviders().empty());
+    EXPECT_EQ(std::vector<int>({4}), first.getAsMap().at(3)->getPeers());
+    EXPECT_TRUE(first.getAsMap().at(3)->getCustomers().empty());
+    EXPECT_EQ(3, first.getIngestStats().conflicts);
+    EXPECT_EQ(0, first.getIngestStats().duplicates);
+
+    AsGraph last;
+    last.setConflictRule(ConflictRule::KEEP_LAST);
+    last.buildGraph("test_conflicts.txt");
+    EXPECT_EQ(std::vector<int>({1}), last.getAsMap().at(2)->getCustomers());
+    EXPECT_TRUE(last.getAsMap().at(1)->getCustomers().empty());
+    EXPECT_EQ(std::vector<int>({4}), last.getAsMap().at(3)->getCustomers());
+    EXPECT_TRUE(last.getAsMap().at(3)->getPeers().empty());
+    EXPECT_TRUE(last.getAsMap().at(4)->getPeers().empty());
+    EXPECT_EQ(1, last.getAdjacencyList().at(3).size());
+    EXPECT_EQ(0, last.getAdjacencyList().count(4));
+    EXPECT_EQ(2, last.getIngestStats().conflicts);
+    EXPECT_EQ(1, last.getIngestStats().duplicates);
+
+    AsGraph dropped;
+    dropped.setConflictRule(ConflictRule::DROP);
+    dropped.buildGraph("test_conflicts.txt");
+    std::filesystem::remove("test_conflicts.txt");
+    for (int asn : {1, 2, 3, 4})
+    {
+        const AS *as = dropped.getAsMap().at(asn);
+        EXPECT_TRUE(as->getProviders().empty() && as->getCustomers().empty() && as->getPeers().empty());
+    }
+    EXPECT_TRUE(dropped.getAdjacencyList().empty());
+    EXPECT_EQ(3, dropped.getIngestStats().conflicts);
+}
+
+// Test that an incremental diff gives the same ranks and topology as a rebuild
+TEST_F(AsGraphTest, IncrementalUpdatesMatchRebuild)
+{
+    std::ofstream base("test_incremental.txt");
+    base << "1|2|-1|bgp\n";
+    base << "2|3|-1|bgp\n";
+    base << "3|4|-1|bgp\n";
+    base << "1|5|-1|bgp\n";
+    base << "5|6|0|bgp\n";
+    base.close();
+
+    // same graph after the diff below
+    std::ofstream updated("test_incremental_updated.txt");
+    updated << "1|2|-1|bgp\n";
+    updated << "2|3|0|bgp\n";
+    updated << "1|5|-1|bgp\n";
+    updated << "5|6|0|bgp\n";
+    updated << "5|4|-1|bgp\n";
+    updated << "4|7|-1|bgp\n";
+    updated.close();
+
+    AsGraph incremental;
+    incremental.buildGraph("test_incremental.txt");
+    ASSERT_TRUE(incremental.flattenGraph());
+    EXPECT_EQ(0, incremental.removeRelationship(4, 3)); // either order works
+    EXPECT_EQ(0, incremental.retypeRelationship(2, 3, RelationshipType::PEER_TO_PEER));
+    EXPECT_EQ(0, incremental.addRelationship(5, 4, RelationshipType::PROVIDER_TO_CUSTOMER));
+    EXPECT_EQ(0, incremental.addRelationship(4, 7, RelationshipType::PROVIDER_TO_CUSTOMER));
+    incremental.commitUpdates();
+
+    AsGraph rebuilt;
+    rebuilt.buildGraph("test_incremental_updated.txt");
+    ASSERT_TRUE(rebuilt.flattenGraph());
+    std::filesystem::remove("test_incremental.txt");
+    std::filesystem::remove("test_incremental_updated.txt");
+
+    // dense indices differ, so compare per ASN
+    auto ranksOf = [](const AsGraph &g)
+    {
+        std::map<int, size_t> ranks;
+        const auto &flattened = g.getFlattenedGraph();
+        for (size_t r = 0; r < flattened.size(); ++r)
+        {
+            for (int asn : flattened[r])
+            {
+                ranks[asn] = r;
+            }
+        }
+        return ranks;
+    };
+    EXPECT_EQ(ranksOf(rebuilt), ranksOf(incremental));
+
+    auto sorted = [](std::vector<int> v)
+    {
+        std::sort(v.begin(), v.end());
+        return v;
+    };
+    for (const auto &pair : rebuilt.getAsMap())
+    {
+        const AS *expected = pair.second;
+        const AS *actual = incremental.getAsMap().at(pair.first);
+        EXPECT_EQ(sorted(expected->getProviders()), sorted(actual->getProviders())) << "AS " << pair.first;
+        EXPECT_EQ(sorted(expected->getCustomers()), sorted(actual->getCustomers())) << "AS " << pair.first;
+        EXPECT_EQ(sorted(expected->getPeers()), sorted(actual->getPeers())) << "AS " << pair.first;
+    }
+    EXPECT_EQ(rebuilt.getAdjacencyList().size(), incremental.getAdjacencyList().size());
+
+    // the CSR topology follows the neighbor vectors after commitUpdates
+    const Topology &topology = incremental.getTopology();
+    ASSERT_EQ(7, topology.size());
+    long idx5 = incremental.indexOf(5);
+    ASSERT_EQ(1, topology.getCustomers(idx5).size());
+    EXPECT_EQ(4, topology.asnOf(*topology.getCustomers(idx5).begin()));
+}
+
+// Test that updates which would create a cycle are rejected
+TEST_F(AsGraphTest, IncrementalUpdatesRejectCycles)
+{
+    graph->buildGraph("test_peers.txt");
+
+    // not flattened yet
+    EXPECT_EQ(-1, graph->addRelationship(400, 600, RelationshipType::PROVIDER_TO_CUSTOMER));
+    ASSERT_TRUE(graph->flattenGraph());
+
+    EXPECT_EQ(0, graph->addRelationship(400, 600, RelationshipType::PROVIDER_TO_CUSTOMER));
+    EXPECT_EQ(-1, graph->addRelationship(600, 300, RelationshipType::PROVIDER_TO_CUSTOMER));
+    EXPECT_EQ(std::vector<int>({600, 300, 400, 600}), graph->getCycle());
+
+    // a rejected retype keeps the old relationship
+    EXPECT_EQ(0, graph->addRelationship(300, 600, RelationshipType::PEER_TO_PEER));
+    EXPECT_EQ(-1, graph->retypeRelationship(600, 300, RelationshipType::PROVIDER_TO_CUSTOMER));
+    EXPECT_TRUE(contains(graph->getAsMap().at(300)->getPeers(), 600));
+    EXPECT_TRUE(contains(graph->getAsMap().at(600)->getPeers(), 300));
+    EXPECT_EQ(-1, graph->removeRelationship(100, 300));
+    EXPECT_EQ(-1, graph->addRelationship(300, 400, RelationshipType::PEER_TO_PEER));
+
+    graph->commitUpdates();
+    EXPECT_FALSE(graph->hasCycle());
+    ASSERT_EQ(3, graph->getFlattenedGraph().size());
+    EXPECT_EQ(std::vector<int>({100, 200, 600}), graph->getFlattenedGraph()[0]);
+}
 // Test nonexistent file handling
 TEST_F(AsGraphTest, NonexistentFile)
 {
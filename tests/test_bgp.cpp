@@ -3,6 +3,7 @@
 #include "Announcement.h"
 #include "Relationships.h"
 #include <vector>
+#include <algorithm>
 
 class BGPTest : public ::testing::Test
 {
@@ -283,6 +284,29 @@ TEST_F(BGPTest, BatchProcessingMultiplePrefixes)
     EXPECT_EQ(3, bgp->getlocalRib().size()); // All processed
 }
 
+TEST_F(BGPTest, LocalRibIteratesPrefixStrings)
+{
+    bgp->enqueueAnnouncement(Announcement("192.168.1.0/24", {200}, 200, Relationship::CUSTOMER));
+    bgp->enqueueAnnouncement(Announcement("10.0.0.0/8", {300}, 300, Relationship::PEER));
+    bgp->processAnnouncements();
+
+    const auto &rib = bgp->getlocalRib();
+    std::vector<std::string> prefixes;
+    for (const auto &entry : rib)
+    {
+        EXPECT_EQ(entry.first, entry.second.getPrefix());
+        prefixes.push_back(entry.first);
+    }
+    std::sort(prefixes.begin(), prefixes.end());
+    EXPECT_EQ(std::vector<std::string>({"10.0.0.0/8", "192.168.1.0/24"}), prefixes);
+
+    // lookups for prefixes that were never interned or have no route
+    EXPECT_TRUE(rib.find("203.0.113.255/32") == rib.end());
+    EXPECT_THROW(rib.at("203.0.113.255/32"), std::out_of_range);
+    EXPECT_EQ(nullptr, rib.findId(PrefixTable::global().intern("172.16.0.0/12")));
+    EXPECT_EQ(300, rib.findId(PrefixTable::global().find("10.0.0.0/8"))->getNextHopAsn());
+}
+
 // ==================== COMPLEX SCENARIOS ====================
 
 TEST_F(BGPTest, ComplexConflictResolution_MultipleUpdates)
@@ -384,3 +408,24 @@ TEST_F(BGPTest, IdenticalAnnouncementsTwice)
     const Announcement &stored = bgp->getlocalRib().at("192.168.1.0/24");
     EXPECT_EQ(2, stored.getAsPath().size());
 }
+
+TEST_F(BGPTest, PendingCandidatesClearedAfterProcess)
+{
+    // the better route arrives first, the losers after it are folded away
+    bgp->enqueueAnnouncement(Announcement("192.168.1.0/24", {200}, 200, Relationship::CUSTOMER));
+    bgp->enqueueAnnouncement(Announcement("192.168.1.0/24", {300}, 300, Relationship::PROVIDER));
+    bgp->enqueueAnnouncement(Announcement("192.168.1.0/24", {400, 500}, 400, Relationship::CUSTOMER));
+    bgp->processAnnouncements();
+
+    EXPECT_EQ(200, bgp->getlocalRib().at("192.168.1.0/24").getNextHopAsn());
+
+    // nothing is left over for the next round
+    bgp->processAnnouncements();
+    EXPECT_EQ(1, bgp->getlocalRib().size());
+    EXPECT_EQ(200, bgp->getlocalRib().at("192.168.1.0/24").getNextHopAsn());
+
+    // a worse route in a later round does not replace the stored one
+    bgp->enqueueAnnouncement(Announcement("192.168.1.0/24", {600}, 600, Relationship::PEER));
+    bgp->processAnnouncements();
+    EXPECT_EQ(200, bgp->getlocalRib().at("192.168.1.0/24").getNextHopAsn());
+}
@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+#include "CaidaParser.h"
+#include "AsGraph.h"
+#include "Relationships.h"
+#include <bzlib.h>
+#include <zlib.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <fstream>
+#include <filesystem>
+
+using Edge = std::tuple<int, int, RelationshipType>;
+
+class CaidaParserTest : public ::testing::Test
+{
+protected:
+    std::vector<Edge> parseString(const std::string &data)
+    {
+        std::vector<Edge> edges;
+        CaidaParser::parse(data.data(), data.data() + data.size(), [&edges](int src, int dst, RelationshipType rel)
+                           { edges.emplace_back(src, dst, rel); });
+        return edges;
+    }
+};
+
+// ==================== PARSE TESTS ====================
+
+TEST_F(CaidaParserTest, ParsesBasicLines)
+{
+    auto edges = parseString("1|2|0|bgp\n2|3|-1|mlp\n");
+    ASSERT_EQ(2, edges.size());
+    EXPECT_EQ(Edge(1, 2, RelationshipType::PEER_TO_PEER), edges[0]);
+    EXPECT_EQ(Edge(2, 3, RelationshipType::PROVIDER_TO_CUSTOMER), edges[1]);
+}
+
+TEST_F(CaidaParserTest, SkipsCommentsAndEmptyLines)
+{
+    auto edges = parseString("# source:topology|BGP\n# header\n\n51823|198047|0|mlp\n\n");
+    ASSERT_EQ(1, edges.size());
+    EXPECT_EQ(Edge(51823, 198047, RelationshipType::PEER_TO_PEER), edges[0]);
+}
+
+TEST_F(CaidaParserTest, HandlesMissingTrailingNewline)
+{
+    auto edges = parseString("1|2|-1|bgp\n3|4|-1");
+    ASSERT_EQ(2, edges.size());
+    EXPECT_EQ(Edge(3, 4, RelationshipType::PROVIDER_TO_CUSTOMER), edges[1]);
+}
+
+TEST_F(CaidaParserTest, HandlesWindowsLineEndings)
+{
+    auto edges = parseString("1|2|0|bgp\r\n\r\n3|4|-1|bgp\r\n");
+    ASSERT_EQ(2, edges.size());
+    EXPECT_EQ(Edge(3, 4, RelationshipType::PROVIDER_TO_CUSTOMER), edges[1]);
+}
+
+TEST_F(CaidaParserTest, SkipsMalformedLines)
+{
+    auto edges = parseString("abc|2|0|bgp\n1|2\n5|6|-1|bgp\n");
+    ASSERT_EQ(1, edges.size());
+    EXPECT_EQ(Edge(5, 6, RelationshipType::PROVIDER_TO_CUSTOMER), edges[0]);
+}
+
+TEST_F(CaidaParserTest, EmptyInput)
+{
+    EXPECT_EQ(0, parseString("").size());
+}
+
+// ==================== FILE TESTS ====================
+
+TEST_F(CaidaParserTest, ParseFileMatchesParse)
+{
+    std::ofstream out("test_parser_file.txt");
+    out << "# comment\n1|2|0|bgp\n2|3|-1|bgp\n";
+    out.close();
+
+    std::vector<Edge> edges;
+    long count = CaidaParser::parseFile("test_parser_file.txt", [&edges](int src, int dst, RelationshipType rel)
+                                        { edges.emplace_back(src, dst, rel); });
+    std::filesystem::remove("test_parser_file.txt");
+
+    EXPECT_EQ(2, count);
+    EXPECT_EQ(parseString("1|2|0|bgp\n2|3|-1|bgp\n"), edges);
+}
+
+TEST_F(CaidaParserTest, ParseFileNonexistent)
+{
+    long count = CaidaParser::parseFile("nonexistent_file.txt", [](int, int, RelationshipType) {});
+    EXPECT_EQ(-1, count);
+}
+
+// ==================== CHUNKED PARSE TESTS ====================
+
+TEST_F(CaidaParserTest, ParseChunksMatchesParse)
+{
+    std::string data = "# header\n";
+    for (int i = 1; i <= 200; ++i)
+    {
+        data += std::to_string(i) + "|" + std::to_string(i + 1) + "|" + (i % 3 == 0 ? "0" : "-1") + "|bgp\n";
+    }
+    std::vector<Edge> expected = parseString(data);
+
+    // includes more threads than lines to force empty chunks
+    for (unsigned threads : {1u, 2u, 3u, 7u, 16u, 512u})
+    {
+        auto buffers = CaidaParser::parseChunks(data.data(), data.data() + data.size(), threads);
+        EXPECT_EQ(threads, buffers.size());
+
+        std::vector<Edge> merged;
+        for (const auto &buffer : buffers)
+        {
+            for (const CaidaEdge &edge : buffer)
+            {
+                merged.emplace_back(edge.src, edge.dst, edge.relType);
+            }
+        }
+        EXPECT_EQ(expected, merged) << "threads = " << threads;
+    }
+}
+
+// ==================== COMPRESSED INPUT TESTS ====================
+
+class CompressedInputTest : public CaidaParserTest
+{
+protected:
+    std::string data;
+    long firstStreamBytes = 0;
+
+    void SetUp() override
+    {
+        data = "# source:topology|BGP\n";
+        for (int i = 1; i <= 500; ++i)
+        {
+            data += std::to_string(i) + "|" + std::to_string(i + 1000) + "|" + (i % 4 == 0 ? "0" : "-1") + "|bgp\n";
+        }
+
+        // bzip2 fixture made of two concatenated streams, like pbzip2 output
+        FILE *file = fopen("test_fixture.txt.bz2", "wb");
+        size_t half = data.size() / 2;
+        for (auto part : {std::make_pair(size_t(0), half), std::make_pair(half, data.size() - half)})
+        {
+            int err;
+            BZFILE *bz = BZ2_bzWriteOpen(&err, file, 9, 0, 0);
+            BZ2_bzWrite(&err, bz, &data[part.first], part.second);
+            BZ2_bzWriteClose(&err, bz, 0, nullptr, nullptr);
+            if (firstStreamBytes == 0)
+            {
+                firstStreamBytes = ftell(file);
+            }
+        }
+        fclose(file);
+
+        gzFile gz = gzopen("test_fixture.txt.gz", "wb");
+        gzwrite(gz, data.data(), data.size());
+        gzclose(gz);
+
+        std::ofstream plain("test_fixture.txt");
+        plain << data;
+        plain.close();
+
+        // valid bzip2 header followed by a truncated body
+        std::ifstream full("test_fixture.txt.bz2", std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(full)), std::istreambuf_iterator<char>());
+        std::ofstream truncated("test_truncated.txt.bz2", std::ios::binary);
+        truncated << bytes.substr(0, bytes.size() / 3);
+        truncated.close();
+
+        // the first stream intact, the second one cut in half
+        std::ofstream brokenTail("test_broken_tail.txt.bz2", std::ios::binary);
+        brokenTail << bytes.substr(0, firstStreamBytes + (bytes.size() - firstStreamBytes) / 2);
+        brokenTail.close();
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove("test_fixture.txt.bz2");
+        std::filesystem::remove("test_fixture.txt.gz");
+        std::filesystem::remove("test_fixture.txt");
+        std::filesystem::remove("test_truncated.txt.bz2");
+        std::filesystem::remove("test_broken_tail.txt.bz2");
+    }
+
+    std::vector<Edge> parseCompressed(const std::string &fileName, size_t blockSize, long &count)
+    {
+        std::vector<Edge> edges;
+        count = CaidaParser::parseCompressedFile(fileName, detectCompression(fileName), [&edges](int src, int dst, RelationshipType rel)
+                                                 { edges.emplace_back(src, dst, rel); }, blockSize);
+        return edges;
+    }
+};
+
+TEST_F(CompressedInputTest, DetectsCompression)
+{
+    EXPECT_EQ(Compression::BZIP2, detectCompression("test_fixture.txt.bz2"));
+    EXPECT_EQ(Compression::GZIP, detectCompression("test_fixture.txt.gz"));
+    EXPECT_EQ(Compression::NONE, detectCompression("test_fixture.txt"));
+    EXPECT_EQ(Compression::NONE, detectCompression("nonexistent_file.txt"));
+}
+
+TEST_F(CompressedInputTest, MatchesPlainText)
+{
+    std::vector<Edge> expected = parseString(data);
+    ASSERT_EQ(500, expected.size());
+
+    // tiny blocks force lines to straddle block boundaries
+    for (size_t blockSize : {size_t(1), size_t(7), size_t(64), size_t(1) << 20})
+    {
+        long count;
+        EXPECT_EQ(expected, parseCompressed("test_fixture.txt.bz2", blockSize, count)) << "bz2 block " << blockSize;
+        EXPECT_EQ(500, count);
+        EXPECT_EQ(expected, parseCompressed("test_fixture.txt.gz", blockSize, count)) << "gz block " << blockSize;
+        EXPECT_EQ(500, count);
+    }
+}
+
+TEST_F(CompressedInputTest, ReportsTruncatedInput)
+{
+    long count;
+    parseCompressed("test_truncated.txt.bz2", 1 << 20, count);
+    EXPECT_EQ(-1, count);
+
+    parseCompressed("nonexistent_file.txt.bz2", 1 << 20, count);
+    EXPECT_EQ(-1, count);
+}
+
+TEST_F(CompressedInputTest, BuildGraphReadsCompressedFiles)
+{
+    AsGraph plainGraph, bz2Graph, gzGraph;
+    ASSERT_EQ(0, plainGraph.buildGraph("test_fixture.txt"));
+    ASSERT_EQ(0, bz2Graph.buildGraph("test_fixture.txt.bz2"));
+    ASSERT_EQ(0, gzGraph.buildGraph("test_fixture.txt.gz"));
+
+    EXPECT_EQ(plainGraph.getAdjacencyList(), bz2Graph.getAdjacencyList());
+    EXPECT_EQ(plainGraph.getAdjacencyList(), gzGraph.getAdjacencyList());
+    EXPECT_EQ(plainGraph.getAsMap().size(), bz2Graph.getAsMap().size());
+
+    AsGraph truncatedGraph;
+    EXPECT_EQ(-1, truncatedGraph.buildGraph("test_truncated.txt.bz2"));
+}
+
+TEST_F(CompressedInputTest, BuildGraphKeepsNothingFromABrokenStream)
+{
+    // the parser hands out the first stream's edges before it sees the error
+    long count;
+    EXPECT_FALSE(parseCompressed("test_broken_tail.txt.bz2", 1 << 10, count).empty());
+    EXPECT_EQ(-1, count);
+
+    AsGraph graph;
+    EXPECT_EQ(-1, graph.buildGraph("test_broken_tail.txt.bz2"));
+    EXPECT_TRUE(graph.getAsMap().empty());
+    EXPECT_EQ(0, graph.getTopology().size());
+}
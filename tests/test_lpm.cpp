@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+#include "AsGraph.h"
+#include "PrefixIndex.h"
+#include "PrefixTable.h"
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+
+class LpmTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // AS1 provider to AS2 and AS3, AS2 provider to AS4
+        std::ofstream graphFile("test_lpm_graph.txt");
+        graphFile << "1|2|-1|bgp\n";
+        graphFile << "1|3|-1|bgp\n";
+        graphFile << "2|4|-1|bgp\n";
+        graphFile.close();
+
+        // AS3 only deploys ROV, so it never learns the invalid /24
+        std::ofstream rovFile("test_lpm_rov.csv");
+        rovFile << "3\n";
+        rovFile.close();
+
+        std::ofstream annFile("test_lpm_anns.csv");
+        annFile << "asn,prefix,rov_invalid\n";
+        annFile << "1,10.0.0.0/8,False\n";
+        annFile << "2,10.1.0.0/16,False\n";
+        annFile << "4,10.1.2.0/24,True\n";
+        annFile << "3,2001:db8::/32,False\n";
+        annFile.close();
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove("test_lpm_graph.txt");
+        std::filesystem::remove("test_lpm_rov.csv");
+        std::filesystem::remove("test_lpm_anns.csv");
+    }
+
+    void runScenario(AsGraph &graph)
+    {
+        graph.loadROVDeployment("test_lpm_rov.csv");
+        graph.buildGraph("test_lpm_graph.txt");
+        graph.flattenGraph();
+        graph.processInitialAnnouncements("test_lpm_anns.csv");
+        graph.propagateUp();
+        graph.propagateAcross();
+        graph.propagateDown();
+        graph.buildPrefixIndex();
+    }
+};
+
+// ==================== PARSING TESTS ====================
+
+TEST_F(LpmTest, ParsePrefixMasksHostBits)
+{
+    IpAddress a, b;
+    uint32_t lenA = 0, lenB = 0;
+    ASSERT_TRUE(PrefixIndex::parsePrefix("10.1.2.3/16", a, lenA));
+    ASSERT_TRUE(PrefixIndex::parsePrefix("10.1.0.0/16", b, lenB));
+    EXPECT_EQ(16u, lenA);
+    EXPECT_EQ(a.hi, b.hi);
+    EXPECT_FALSE(a.v6);
+
+    ASSERT_TRUE(PrefixIndex::parsePrefix("2001:db8:ffff::/32", a, lenA));
+    EXPECT_TRUE(a.v6);
+    EXPECT_EQ(0x20010db800000000ULL, a.hi);
+    EXPECT_EQ(0u, a.lo);
+}
+
+TEST_F(LpmTest, ParseRejectsMalformed)
+{
+    IpAddress a;
+    uint32_t len = 0;
+    EXPECT_FALSE(PrefixIndex::parsePrefix("10.0.0.0", a, len));
+    EXPECT_FALSE(PrefixIndex::parsePrefix("10.0.0.0/33", a, len));
+    EXPECT_FALSE(PrefixIndex::parsePrefix("10.0.0.0/", a, len));
+    EXPECT_FALSE(PrefixIndex::parsePrefix("10.0.0/8", a, len));
+    EXPECT_FALSE(PrefixIndex::parsePrefix("::/129", a, len));
+    EXPECT_FALSE(PrefixIndex::parseAddress("not an ip", a));
+}
+
+// ==================== TRIE TESTS ====================
+
+TEST_F(LpmTest, NestedPrefixesLongestFirst)
+{
+    PrefixTable table;
+    uint32_t p8 = table.intern("10.0.0.0/8");
+    uint32_t p24 = table.intern("10.1.2.0/24");
+    uint32_t p16 = table.intern("10.1.0.0/16");
+    uint32_t other = table.intern("10.2.0.0/16");
+    uint32_t all = table.intern("0.0.0.0/0");
+    uint32_t host = table.intern("10.1.2.3/32");
+    table.intern("garbage");
+
+    PrefixIndex index;
+    index.build(table);
+    EXPECT_EQ(6u, index.size());
+    EXPECT_EQ(1u, index.skippedCount());
+
+    IpAddress addr;
+    std::vector<uint32_t> found;
+    ASSERT_TRUE(PrefixIndex::parseAddress("10.1.2.3", addr));
+    index.matches(addr, found);
+    EXPECT_EQ(std::vector<uint32_t>({host, p24, p16, p8, all}), found);
+
+    found.clear();
+    ASSERT_TRUE(PrefixIndex::parseAddress("10.2.200.1", addr));
+    index.matches(addr, found);
+    EXPECT_EQ(std::vector<uint32_t>({other, p8, all}), found);
+
+    found.clear();
+    ASSERT_TRUE(PrefixIndex::parseAddress("192.168.0.1", addr));
+    index.matches(addr, found);
+    EXPECT_EQ(std::vector<uint32_t>({all}), found);
+
+    // IPv4 prefixes never match IPv6 addresses
+    found.clear();
+    ASSERT_TRUE(PrefixIndex::parseAddress("::a01:203", addr));
+    index.matches(addr, found);
+    EXPECT_TRUE(found.empty());
+}
+
+TEST_F(LpmTest, SamePrefixWrittenTwiceMatchesBothIds)
+{
+    PrefixTable table;
+    uint32_t p8 = table.intern("10.0.0.0/8");
+    uint32_t clean = table.intern("10.1.0.0/16");
+    uint32_t hostBits = table.intern("10.1.2.3/16");
+    uint32_t moreHostBits = table.intern("10.1.255.255/16");
+
+    PrefixIndex index;
+    index.build(table);
+    EXPECT_EQ(4u, index.size());
+
+    IpAddress addr;
+    std::vector<uint32_t> found;
+    ASSERT_TRUE(PrefixIndex::parseAddress("10.1.7.7", addr));
+    index.matches(addr, found);
+    EXPECT_EQ(std::vector<uint32_t>({clean, hostBits, moreHostBits, p8}), found);
+}
+
+TEST_F(LpmTest, MatchesBruteForce)
+{
+    // nested /8 to /24 prefixes under 10.0.0.0/8, checked against a linear scan
+    PrefixTable table;
+    std::vector<std::pair<uint32_t, uint32_t>> prefixes; // (address, length)
+    for (uint32_t len = 8; len <= 24; len += 4)
+    {
+        for (uint32_t v = 0; v < 8; ++v)
+        {
+            // v fills the lowest bits of the prefix, the /8 itself has none to fill
+            uint32_t addr = len == 8 ? 10u << 24 : (10u << 24) | (v << (32 - len));
+            std::string text = std::to_string(addr >> 24) + "." + std::to_string((addr >> 16) & 255) + "." +
+                               std::to_string((addr >> 8) & 255) + "." + std::to_string(addr & 255) + "/" +
+                               std::to_string(len);
+            if (table.find(text) == PrefixTable::NOT_FOUND)
+            {
+                table.intern(text);
+                prefixes.push_back({addr, len});
+            }
+        }
+    }
+    PrefixIndex index;
+    index.build(table);
+
+    for (uint32_t probe = 0; probe < 4096; ++probe)
+    {
+        uint32_t ip = (10u << 24) | (probe * 2654435761u >> 8);
+        std::string text = std::to_string(ip >> 24) + "." + std::to_string((ip >> 16) & 255) + "." +
+                           std::to_string((ip >> 8) & 255) + "." + std::to_string(ip & 255);
+
+        std::vector<uint32_t> expected;
+        for (uint32_t len = 32; len-- > 0;)
+        {
+            for (uint32_t id = 0; id < prefixes.size(); ++id)
+            {
+                auto [addr, plen] = prefixes[id];
+                if (plen == len + 1 && (ip & (~0u << (32 - plen))) == addr)
+                {
+                    expected.push_back(id);
+                }
+            }
+        }
+
+        IpAddress parsed;
+        ASSERT_TRUE(PrefixIndex::parseAddress(text, parsed));
+        std::vector<uint32_t> found;
+        index.matches(parsed, found);
+        EXPECT_EQ(expected, found) << text;
+    }
+}
+
+// ==================== ROUTE LOOKUP TESTS ====================
+
+TEST_F(LpmTest, LookupRoutesUsesLongestPrefixInEachRib)
+{
+    AsGraph graph;
+    runScenario(graph);
+
+    std::vector<std::string> addresses = {"10.1.2.3", "10.1.9.9", "10.200.0.1", "192.0.2.1", "2001:db8::1", "bogus"};
+    std::vector<int> asns = {1, 3, 4, 999};
+    std::vector<RouteMatch> matches = graph.lookupRoutes(addresses, asns);
+    ASSERT_EQ(addresses.size() * asns.size(), matches.size());
+
+    auto prefixAt = [&](size_t row, size_t col)
+    {
+        const RouteMatch &m = matches[row * asns.size() + col];
+        return m.found() ? PrefixTable::global().get(m.prefixId) : std::string("-");
+    };
+
+    // AS1 learned all three nested prefixes
+    EXPECT_EQ("10.1.2.0/24", prefixAt(0, 0));
+    EXPECT_EQ("10.1.0.0/16", prefixAt(1, 0));
+    EXPECT_EQ("10.0.0.0/8", prefixAt(2, 0));
+    // AS3 runs ROV and never got the invalid /24, so it falls back to the /16
+    EXPECT_EQ("10.1.0.0/16", prefixAt(0, 1));
+    // AS4 originates the /24
+    EXPECT_EQ("10.1.2.0/24", prefixAt(0, 2));
+    EXPECT_EQ(Relationship::ORIGIN, matches[0 * asns.size() + 2].route.getRelationship());
+    // no covering prefix, IPv6, bad input, unknown AS
+    EXPECT_EQ("-", prefixAt(3, 0));
+    EXPECT_EQ("2001:db8::/32", prefixAt(4, 0));
+    EXPECT_EQ("-", prefixAt(5, 0));
+    EXPECT_EQ("-", prefixAt(0, 3));
+
+    // the match carries the AS's route
+    const RouteMatch &viaProvider = matches[1 * asns.size() + 2];
+    ASSERT_TRUE(viaProvider.found());
+    EXPECT_EQ(2, viaProvider.route.getNextHopAsn());
+    EXPECT_EQ(Relationship::PROVIDER, viaProvider.route.getRelationship());
+}
+
+TEST_F(LpmTest, LookupRoutesFindsPrefixWrittenWithHostBits)
+{
+    // the clean spelling gets the lower id but nobody announces it
+    PrefixTable::global().intern("10.1.0.0/16");
+    std::ofstream annFile("test_lpm_anns.csv");
+    annFile << "asn,prefix\n";
+    annFile << "1,10.0.0.0/8\n";
+    annFile << "4,10.1.2.3/16\n";
+    annFile.close();
+
+    AsGraph graph;
+    runScenario(graph);
+
+    std::vector<RouteMatch> matches = graph.lookupRoutes({"10.1.9.9"}, {1, 4});
+    ASSERT_EQ(2u, matches.size());
+    EXPECT_EQ("10.1.2.3/16", PrefixTable::global().get(matches[0].prefixId));
+    EXPECT_EQ(2, matches[0].route.getNextHopAsn());
+    EXPECT_EQ("10.1.2.3/16", PrefixTable::global().get(matches[1].prefixId));
+    EXPECT_EQ(Relationship::ORIGIN, matches[1].route.getRelationship());
+}
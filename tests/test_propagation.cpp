@@ -2,8 +2,12 @@
 #include "AsGraph.h"
 #include "Announcement.h"
 #include "Relationships.h"
+#include "PrefixTable.h"
+#include "collect_ribs.h"
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <string>
 
 class AsGraphPropagationTest : public ::testing::Test
 {
@@ -60,6 +64,29 @@ protected:
         rovDeployFile.close();
     }
 
+    /*
+    Loads the complex topology and annsFile into g and runs a full
+    propagation, rank by rank or with propagateByPrefix(shards).
+     */
+    static RibDump propagate(AsGraph &g, const string &annsFile = "test_complex_anns.csv", size_t shards = RANK_BY_RANK)
+    {
+        g.loadROVDeployment("test_rov_deployment.csv");
+        g.buildGraph("test_complex_graph.txt");
+        g.flattenGraph();
+        g.processInitialAnnouncements(annsFile);
+        if (shards == RANK_BY_RANK)
+        {
+            g.propagateUp();
+            g.propagateAcross();
+            g.propagateDown();
+        }
+        else
+        {
+            g.propagateByPrefix(shards);
+        }
+        return collectRibs(g);
+    }
+
     void cleanupTestFiles()
     {
         std::filesystem::remove("test_propagation_graph.txt");
@@ -105,7 +132,7 @@ TEST_F(AsGraphPropagationTest, ProcessInitialAnnouncements_BasicTopology)
     const auto &asMap = graph->getAsMap();
 
     // AS3 should have the announcement in its RIB
-    AS *as3 = asMap.at(3).get();
+    AS *as3 = asMap.at(3);
     const auto &rib3 = as3->getPolicy().getlocalRib();
 
     EXPECT_EQ(1, rib3.size());
@@ -121,12 +148,40 @@ TEST_F(AsGraphPropagationTest, ProcessInitialAnnouncements_NonexistentFile)
     graph->processInitialAnnouncements("nonexistent_anns.csv");
 
     const auto &asMap = graph->getAsMap();
-    AS *as3 = asMap.at(3).get();
+    AS *as3 = asMap.at(3);
     const auto &rib3 = as3->getPolicy().getlocalRib();
 
     EXPECT_EQ(0, rib3.size()); // No announcements processed
 }
 
+TEST_F(AsGraphPropagationTest, ProcessInitialAnnouncements_OptionalRovColumn)
+{
+    graph->buildGraph("test_propagation_graph.txt");
+    graph->flattenGraph();
+
+    // rows with and without the rov_invalid column, one with a Windows line ending
+    std::ofstream annFile("test_mixed_anns.csv");
+    annFile << "asn,prefix,rov_invalid\n";
+    annFile << "3,192.168.1.0/24\n";
+    annFile << "2,10.0.0.0/8,True\r\n";
+    annFile << "1,172.16.0.0/12,False\n";
+    annFile.close();
+
+    graph->processInitialAnnouncements("test_mixed_anns.csv");
+    std::filesystem::remove("test_mixed_anns.csv");
+
+    const auto &asMap = graph->getAsMap();
+    const auto &rib3 = asMap.at(3)->getPolicy().getlocalRib();
+    const auto &rib2 = asMap.at(2)->getPolicy().getlocalRib();
+    const auto &rib1 = asMap.at(1)->getPolicy().getlocalRib();
+    ASSERT_TRUE(rib3.find("192.168.1.0/24") != rib3.end());
+    ASSERT_TRUE(rib2.find("10.0.0.0/8") != rib2.end());
+    ASSERT_TRUE(rib1.find("172.16.0.0/12") != rib1.end());
+    EXPECT_FALSE(rib3.find("192.168.1.0/24")->second.isRovInvalid());
+    EXPECT_TRUE(rib2.find("10.0.0.0/8")->second.isRovInvalid());
+    EXPECT_FALSE(rib1.find("172.16.0.0/12")->second.isRovInvalid());
+}
+
 // ==================== FLATTEN GRAPH TESTS ====================
 
 TEST_F(AsGraphPropagationTest, FlattenGraph_LinearTopology)
@@ -202,7 +257,7 @@ TEST_F(AsGraphPropagationTest, PropagateUp_LinearTopology)
 
     // AS3 originates 192.168.1.0/24
     // After propagateUp, AS2 should have it (AS3's provider)
-    AS *as2 = asMap.at(2).get();
+    AS *as2 = asMap.at(2);
     const auto &rib2 = as2->getPolicy().getlocalRib();
 
     EXPECT_GT(rib2.size(), 0);
@@ -227,12 +282,12 @@ TEST_F(AsGraphPropagationTest, PropagateUp_PropagatesMultipleHops)
     const auto &asMap = graph->getAsMap();
 
     // AS1 should eventually receive the announcement from AS3
-    AS *as1 = asMap.at(1).get();
+    AS *as1 = asMap.at(1);
     const auto &rib1 = as1->getPolicy().getlocalRib();
 
     // After propagateUp, AS1 might have it (depends on processing order)
     // At minimum AS2 should have it
-    AS *as2 = asMap.at(2).get();
+    AS *as2 = asMap.at(2);
     const auto &rib2 = as2->getPolicy().getlocalRib();
 
     EXPECT_GT(rib2.size(), 0);
@@ -254,8 +309,8 @@ TEST_F(AsGraphPropagationTest, PropagateAcross_PeerRelationships)
 
     // After propagation, peers should exchange routes
     // AS1 and AS2 are peers
-    AS *as1 = asMap.at(1).get();
-    AS *as2 = asMap.at(2).get();
+    AS *as1 = asMap.at(1);
+    AS *as2 = asMap.at(2);
 
     const auto &rib1 = as1->getPolicy().getlocalRib();
     const auto &rib2 = as2->getPolicy().getlocalRib();
@@ -284,7 +339,7 @@ TEST_F(AsGraphPropagationTest, PropagateDown_LinearTopology)
     const auto &asMap = graph->getAsMap();
 
     // AS2 (customer of AS1) should receive the announcement
-    AS *as2 = asMap.at(2).get();
+    AS *as2 = asMap.at(2);
     const auto &rib2 = as2->getPolicy().getlocalRib();
 
     EXPECT_GT(rib2.size(), 0);
@@ -310,7 +365,7 @@ TEST_F(AsGraphPropagationTest, PropagateDown_MultipleLevels)
     const auto &asMap = graph->getAsMap();
 
     // AS3 (at the bottom) should eventually receive the announcement
-    AS *as3 = asMap.at(3).get();
+    AS *as3 = asMap.at(3);
     const auto &rib3 = as3->getPolicy().getlocalRib();
 
     EXPECT_GT(rib3.size(), 0);
@@ -339,7 +394,7 @@ TEST_F(AsGraphPropagationTest, FullPropagation_UpAcrossDown)
     int total_routes = 0;
     for (const auto &pair : asMap)
     {
-        AS *as = pair.second.get();
+        AS *as = pair.second;
         total_routes += as->getPolicy().getlocalRib().size();
     }
 
@@ -358,7 +413,7 @@ TEST_F(AsGraphPropagationTest, FullPropagation_ASPathGrowth)
     const auto &asMap = graph->getAsMap();
 
     // Check AS path length increases as announcement propagates up
-    AS *as3 = asMap.at(3).get();
+    AS *as3 = asMap.at(3);
     const auto &rib3 = as3->getPolicy().getlocalRib();
 
     if (rib3.find("192.168.1.0/24") != rib3.end())
@@ -369,6 +424,27 @@ TEST_F(AsGraphPropagationTest, FullPropagation_ASPathGrowth)
     }
 }
 
+TEST_F(AsGraphPropagationTest, FullPropagation_PathsLiveInGraphPool)
+{
+    graph->buildGraph("test_complex_graph.txt");
+    graph->flattenGraph();
+
+    size_t globalNodes = PathPool::global().size();
+    graph->processInitialAnnouncements("test_complex_anns.csv");
+    graph->propagateUp();
+    graph->propagateAcross();
+    graph->propagateDown();
+
+    // nothing the graph does touches the process-wide pool
+    EXPECT_EQ(globalNodes, PathPool::global().size());
+    EXPECT_GT(graph->getPathPool().size(), 1);
+
+    const auto &rib3 = graph->getAsMap().at(3)->getPolicy().getlocalRib();
+    Announcement ann = rib3.at("10.0.0.0/8");
+    EXPECT_EQ(&graph->getPathPool(), &ann.getPathPool());
+    EXPECT_EQ(std::vector<int>({3, 4}), ann.getAsPath());
+}
+
 // ==================== EMPTY GRAPH EDGE CASES ====================
 
 TEST_F(AsGraphPropagationTest, EmptyGraph_NoCrash)
@@ -399,7 +475,7 @@ TEST_F(AsGraphPropagationTest, NoAnnouncements_NoCrash)
     // All RIBs should be empty
     for (const auto &pair : asMap)
     {
-        AS *as = pair.second.get();
+        AS *as = pair.second;
         EXPECT_EQ(0, as->getPolicy().getlocalRib().size());
     }
 }
@@ -456,3 +532,237 @@ TEST_F(AsGraphPropagationTest, FlattenedGraph_AllASesIncluded)
 
     EXPECT_EQ(asMap.size(), flattenedAses.size());
 }
+
+// ==================== RIB LAYOUT TESTS ====================
+
+TEST_F(AsGraphPropagationTest, RibLayout_AutoPicksDenseForFewPrefixes)
+{
+    graph->buildGraph("test_complex_graph.txt");
+    graph->flattenGraph();
+    EXPECT_EQ(graph->getRibLayout(), RibLayout::SPARSE);
+
+    graph->processInitialAnnouncements("test_complex_anns.csv");
+
+    // two prefixes that reach every AS fill every dense slot
+    EXPECT_EQ(graph->getRibLayout(), RibLayout::DENSE);
+}
+
+TEST_F(AsGraphPropagationTest, RibLayout_SparseAndDenseMatch)
+{
+    auto run = [](RibLayout layout)
+    {
+        AsGraph g;
+        g.setRibLayout(layout);
+        RibDump ribs = propagate(g);
+        EXPECT_EQ(g.getRibLayout(), layout);
+        return ribs;
+    };
+
+    auto sparse = run(RibLayout::SPARSE);
+    auto dense = run(RibLayout::DENSE);
+    EXPECT_FALSE(sparse.empty());
+    EXPECT_EQ(sparse, dense);
+}
+
+TEST_F(AsGraphPropagationTest, RibLayout_LaterPrefixesOverflowDenseRows)
+{
+    graph->setRibLayout(RibLayout::DENSE);
+    graph->buildGraph("test_complex_graph.txt");
+    graph->flattenGraph();
+    graph->processInitialAnnouncements("test_complex_anns.csv");
+
+    // a prefix seeded after the rows were sized lands past their width
+    std::ofstream annFile("test_overflow_anns.csv");
+    annFile << "asn,prefix\n";
+    annFile << "4,203.0.113.0/24\n";
+    annFile.close();
+    graph->processInitialAnnouncements("test_overflow_anns.csv");
+    std::filesystem::remove("test_overflow_anns.csv");
+
+    const auto &rib = graph->getAsMap().at(4)->getPolicy().getlocalRib();
+    EXPECT_EQ(rib.getLayout(), RibLayout::DENSE);
+    EXPECT_EQ(rib.size(), 2);
+    EXPECT_NE(rib.find("10.0.0.0/8"), rib.end());
+    EXPECT_NE(rib.find("203.0.113.0/24"), rib.end());
+    EXPECT_EQ(rib.find("172.16.0.0/12"), rib.end());
+
+    size_t visited = 0;
+    for (const auto &entry : rib)
+    {
+        EXPECT_EQ(entry.second.getNextHopAsn(), 4);
+        ++visited;
+    }
+    EXPECT_EQ(visited, 2);
+}
+
+// ==================== RUN ARENA TESTS ====================
+
+TEST_F(AsGraphPropagationTest, ClearRoutes_SecondRunMatchesFirst)
+{
+    graph->loadROVDeployment("test_rov_deployment.csv");
+    graph->buildGraph("test_complex_graph.txt");
+    graph->flattenGraph();
+
+    auto run = [this]()
+    {
+        graph->processInitialAnnouncements("test_complex_anns.csv");
+        graph->propagateUp();
+        graph->propagateAcross();
+        graph->propagateDown();
+        return collectRibs(*graph);
+    };
+
+    auto first = run();
+    EXPECT_GT(graph->arenaBytes(), 0);
+    size_t pathNodes = graph->getPathPool().size();
+    EXPECT_GT(pathNodes, 1);
+
+    graph->clearRoutes();
+    EXPECT_EQ(graph->arenaBytes(), 0);
+    EXPECT_EQ(graph->getPathPool().size(), 1); // only the empty path is left
+    for (const auto &[asn, as] : graph->getAsMap())
+    {
+        EXPECT_TRUE(as->getPolicy().getlocalRib().empty());
+    }
+
+    EXPECT_EQ(run(), first);
+    // the second run interns the same paths again instead of piling on top of the first
+    EXPECT_EQ(graph->getPathPool().size(), pathNodes);
+}
+
+TEST_F(AsGraphPropagationTest, RunArena_ExternalResourceIsUsed)
+{
+    // routes come from the caller's resource, the graph's own arena stays empty
+    RunArena external;
+    AsGraph g(&external);
+    g.setRibLayout(RibLayout::SPARSE);
+    g.buildGraph("test_complex_graph.txt");
+    g.flattenGraph();
+    g.processInitialAnnouncements("test_complex_anns.csv");
+    g.propagateUp();
+    g.propagateAcross();
+    g.propagateDown();
+
+    EXPECT_GT(external.bytesAllocated(), 0);
+    EXPECT_EQ(g.arenaBytes(), 0);
+    EXPECT_EQ(g.getAsMap().at(1)->getPolicy().getlocalRib().size(), 2);
+}
+
+// ==================== PULL ENGINE TESTS ====================
+
+TEST_F(AsGraphPropagationTest, PullEngine_MatchesPush)
+{
+    auto run = [](PropagationEngine engine)
+    {
+        AsGraph g;
+        g.setPropagationEngine(engine);
+        g.setThreadCount(3);
+        return propagate(g);
+    };
+
+    auto push = run(PropagationEngine::PUSH);
+    EXPECT_EQ(push.size(), 5);
+    EXPECT_EQ(run(PropagationEngine::PULL), push);
+}
+
+TEST_F(AsGraphPropagationTest, PullEngine_PhasesMatchPushOneByOne)
+{
+    // the RIBs agree after every phase, not only at the end
+    AsGraph push;
+    AsGraph pull;
+    pull.setPropagationEngine(PropagationEngine::PULL);
+    EXPECT_EQ(pull.getPropagationEngine(), PropagationEngine::PULL);
+    for (AsGraph *g : {&push, &pull})
+    {
+        g->buildGraph("test_complex_graph.txt");
+        g->flattenGraph();
+        g->processInitialAnnouncements("test_complex_anns.csv");
+    }
+
+    push.propagateUp();
+    pull.propagateUp();
+    EXPECT_EQ(collectRibs(pull), collectRibs(push));
+    push.propagateAcross();
+    pull.propagateAcross();
+    EXPECT_EQ(collectRibs(pull), collectRibs(push));
+    push.propagateDown();
+    pull.propagateDown();
+    EXPECT_EQ(collectRibs(pull), collectRibs(push));
+}
+
+// ==================== PREFIX SHARDED TESTS ====================
+
+TEST_F(AsGraphPropagationTest, PrefixSharded_MatchesRankByRank)
+{
+    // a third prefix so the shards can split the id range unevenly
+    std::ofstream annFile("test_sharded_anns.csv");
+    annFile << "asn,prefix,rov_invalid\n";
+    annFile << "4,10.0.0.0/8,False\n";
+    annFile << "5,172.16.0.0/12,False\n";
+    annFile << "4,198.51.100.0/24,True\n";
+    annFile.close();
+
+    auto run = [](RibLayout layout, size_t shards)
+    {
+        AsGraph g;
+        g.setRibLayout(layout);
+        g.setThreadCount(2);
+        return propagate(g, "test_sharded_anns.csv", shards);
+    };
+
+    for (RibLayout layout : {RibLayout::SPARSE, RibLayout::DENSE})
+    {
+        auto expected = run(layout, RANK_BY_RANK);
+        // AS4 sees all three, the invalid one never gets past the ROV ASes 3 and 2
+        EXPECT_EQ(expected.at(4).size(), 3);
+        EXPECT_EQ(expected.at(1).count("198.51.100.0/24"), 0);
+        for (size_t shards : {1, 2, 3, 50})
+        {
+            EXPECT_EQ(run(layout, shards), expected) << shards << " shards";
+        }
+    }
+    std::filesystem::remove("test_sharded_anns.csv");
+}
+
+TEST_F(AsGraphPropagationTest, PrefixSharded_CutsBySeededIds)
+{
+    // ids far apart in the shared table, as when other graphs interned prefixes in between
+    std::ofstream annFile("test_sharded_gap_anns.csv");
+    annFile << "asn,prefix,rov_invalid\n";
+    const char *seeded[] = {"10.0.0.0/8", "172.16.0.0/12", "198.51.100.0/24", "203.0.113.0/24"};
+    for (int i = 0; i < 4; ++i)
+    {
+        PrefixTable::global().intern(seeded[i]);
+        for (int filler = 0; filler < 500; ++filler)
+        {
+            PrefixTable::global().intern("100." + std::to_string(i) + "." + std::to_string(filler / 256) + "." +
+                                         std::to_string(filler % 256) + "/32");
+        }
+        annFile << (i % 2 == 0 ? 4 : 5) << "," << seeded[i] << ",False\n";
+    }
+    annFile << "4,10.0.0.0/8,False\n";
+    annFile.close();
+
+    auto run = [](RibLayout layout, size_t shards)
+    {
+        AsGraph g;
+        g.setRibLayout(layout);
+        g.setThreadCount(2);
+        RibDump ribs = propagate(g, "test_sharded_gap_anns.csv", shards);
+        // a prefix seeded twice is one id
+        EXPECT_EQ(g.getSeededPrefixIds().size(), 4);
+        EXPECT_TRUE(std::is_sorted(g.getSeededPrefixIds().begin(), g.getSeededPrefixIds().end()));
+        return ribs;
+    };
+
+    for (RibLayout layout : {RibLayout::SPARSE, RibLayout::DENSE})
+    {
+        auto expected = run(layout, RANK_BY_RANK);
+        EXPECT_EQ(expected.at(1).size(), 4);
+        for (size_t shards : {1, 2, 3, 4})
+        {
+            EXPECT_EQ(run(layout, shards), expected) << shards << " shards";
+        }
+    }
+    std::filesystem::remove("test_sharded_gap_anns.csv");
+}
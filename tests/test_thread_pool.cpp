@@ -0,0 +1,449 @@
+#include <gtest/gtest.h>
+#include "ThreadPool.h"
+#include "AsGraph.h"
+#include "collect_ribs.h"
+#include <fstream>
+#include <filesystem>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+class ThreadPoolTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        /*
+        Wide enough that every rank is split over the pool: 200 stubs under
+        20 mid-tier providers under 4 peered tier-1s.
+         */
+        std::ofstream graphFile("test_pool_graph.txt");
+        for (int t = 1; t <= 4; ++t)
+        {
+            for (int other = t + 1; other <= 4; ++other)
+            {
+                graphFile << t << "|" << other << "|0|bgp\n";
+            }
+        }
+        for (int mid = 100; mid < 120; ++mid)
+        {
+            graphFile << 1 + mid % 4 << "|" << mid << "|-1|bgp\n";
+            graphFile << 1 + (mid + 1) % 4 << "|" << mid << "|-1|bgp\n";
+        }
+        for (int stub = 1000; stub < 1200; ++stub)
+        {
+            graphFile << 100 + stub % 20 << "|" << stub << "|-1|bgp\n";
+            graphFile << 100 + (stub + 7) % 20 << "|" << stub << "|-1|bgp\n";
+        }
+        graphFile.close();
+
+        std::ofstream rovFile("test_pool_rov.csv");
+        for (int asn = 100; asn < 110; ++asn)
+        {
+            rovFile << asn << "\n";
+        }
+        rovFile.close();
+
+        std::ofstream annFile("test_pool_anns.csv");
+        annFile << "asn,prefix,rov_invalid\n";
+        annFile << "1000,10.0.0.0/8,False\n";
+        annFile << "1100,10.0.0.0/8,False\n";
+        annFile << "1150,10.1.0.0/16,True\n";
+        annFile << "3,192.0.2.0/24,False\n";
+        annFile.close();
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove("test_pool_graph.txt");
+        std::filesystem::remove("test_pool_rov.csv");
+        std::filesystem::remove("test_pool_anns.csv");
+        std::filesystem::remove("test_pool_mesh.txt");
+        std::filesystem::remove("test_pool_mesh_anns.csv");
+    }
+
+    /*
+    Loads the test files into g and runs a full propagation with engine and
+    split, rank by rank or with propagateByPrefix(shards). threads > 0 gives
+    g a pool of its own with that many threads first.
+     */
+    static RibDump propagate(AsGraph &g, PropagationEngine engine = PropagationEngine::PUSH, unsigned threads = 0,
+                             size_t shards = RANK_BY_RANK, RankSplit split = RankSplit::COST)
+    {
+        g.setPropagationEngine(engine);
+        g.setRankSplit(split);
+        if (threads > 0)
+        {
+            g.setThreadCount(threads);
+        }
+        g.loadROVDeployment("test_pool_rov.csv");
+        g.buildGraph("test_pool_graph.txt");
+        g.flattenGraph();
+        g.processInitialAnnouncements("test_pool_anns.csv");
+        if (shards == RANK_BY_RANK)
+        {
+            g.propagateUp();
+            g.propagateAcross();
+            g.propagateDown();
+        }
+        else
+        {
+            g.propagateByPrefix(shards);
+        }
+        return collectRibs(g);
+    }
+
+    // the same on a fresh graph running on pool, nullptr for the graph's own
+    static RibDump propagate(ThreadPool *pool, PropagationEngine engine = PropagationEngine::PUSH)
+    {
+        AsGraph g(nullptr, pool);
+        return propagate(g, engine);
+    }
+};
+
+// ==================== PARALLEL FOR TESTS ====================
+
+TEST_F(ThreadPoolTest, ParallelForCoversEveryIndexOnce)
+{
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+
+    for (size_t count : {0, 1, 7, 31, 32, 33, 1000, 4097})
+    {
+        for (size_t chunk : {1, 8, 64})
+        {
+            std::vector<std::atomic<int>> hits(count);
+            pool.parallelFor(count, chunk, [&](size_t begin, size_t end)
+                             {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    hits[i].fetch_add(1);
+                } });
+            for (size_t i = 0; i < count; ++i)
+            {
+                ASSERT_EQ(hits[i].load(), 1) << "count " << count << " chunk " << chunk << " index " << i;
+            }
+        }
+    }
+}
+
+TEST_F(ThreadPoolTest, SmallRangesRunOnTheCaller)
+{
+    ThreadPool pool(4);
+    std::thread::id caller = std::this_thread::get_id();
+    bool onCaller = true;
+    size_t calls = 0;
+    pool.parallelFor(8, 8, [&](size_t, size_t)
+                     { onCaller = std::this_thread::get_id() == caller;
+                       ++calls; });
+    EXPECT_TRUE(onCaller);
+    EXPECT_EQ(calls, 1);
+}
+
+TEST_F(ThreadPoolTest, CallsNeverExceedTheChunk)
+{
+    ThreadPool pool(3);
+    std::atomic<size_t> covered{0};
+    std::atomic<bool> tooLong{false};
+    pool.parallelFor(1001, 10, [&](size_t begin, size_t end)
+                     {
+        if (end - begin > 10 || begin % 10 != 0)
+        {
+            tooLong = true;
+        }
+        covered += end - begin; });
+    EXPECT_FALSE(tooLong);
+    EXPECT_EQ(covered.load(), 1001);
+}
+
+TEST_F(ThreadPoolTest, SkewedRunIsStolen)
+{
+    // the caller's half is slow, the worker finishes its own half and takes the rest
+    ThreadPool pool(2);
+    std::vector<std::atomic<int>> hits(64);
+    pool.parallelFor(hits.size(), 1, [&](size_t begin, size_t end)
+                     {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (i < hits.size() / 2)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            hits[i].fetch_add(1);
+        } });
+    for (const auto &h : hits)
+    {
+        EXPECT_EQ(h.load(), 1);
+    }
+    EXPECT_GT(pool.stealCount(), 0);
+}
+
+TEST_F(ThreadPoolTest, ManyRoundsReuseTheWorkers)
+{
+    // rounds back to back is the rank loop, every one must be complete when parallelFor returns
+    ThreadPool pool(3);
+    std::vector<int> values(300, 0);
+    for (int round = 1; round <= 2000; ++round)
+    {
+        pool.parallelFor(values.size(), 1, [&](size_t begin, size_t end)
+                         {
+            for (size_t i = begin; i < end; ++i)
+            {
+                ++values[i];
+            } });
+        ASSERT_EQ(values.front(), round);
+        ASSERT_EQ(values.back(), round);
+    }
+}
+
+TEST_F(ThreadPoolTest, SingleThreadPoolStartsNoWorkers)
+{
+    ThreadPool pool(1);
+    EXPECT_EQ(pool.size(), 1);
+    size_t covered = 0;
+    pool.parallelFor(100, 1, [&](size_t begin, size_t end)
+                     { covered += end - begin; });
+    EXPECT_EQ(covered, 100);
+}
+
+TEST_F(ThreadPoolTest, BoundsGiveUnevenChunks)
+{
+    ThreadPool pool(3);
+    std::vector<size_t> bounds = {0, 1, 2, 50, 51, 400};
+    std::vector<std::atomic<int>> hits(400);
+    std::atomic<bool> offBounds{false};
+    pool.parallelFor(bounds, [&](size_t begin, size_t end)
+                     {
+        if (std::find(bounds.begin(), bounds.end(), begin) == bounds.end() ||
+            std::find(bounds.begin(), bounds.end(), end) == bounds.end())
+        {
+            offBounds = true;
+        }
+        for (size_t i = begin; i < end; ++i)
+        {
+            hits[i].fetch_add(1);
+        } });
+    EXPECT_FALSE(offBounds);
+    for (const auto &h : hits)
+    {
+        EXPECT_EQ(h.load(), 1);
+    }
+    EXPECT_EQ(pool.lastRound().chunks, 5);
+}
+
+TEST_F(ThreadPoolTest, StatsCountBusyTimeAndChunks)
+{
+    ThreadPool pool(2);
+    pool.parallelFor(4, 1, [](size_t, size_t)
+                     { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+
+    const RoundStats &round = pool.lastRound();
+    EXPECT_EQ(round.chunks, 4);
+    EXPECT_GE(round.maxChunkMs, 1.5);
+    EXPECT_GE(round.workMs, 4 * 1.5);
+    EXPECT_GE(round.criticalMs, round.workMs / 2);
+    EXPECT_LE(round.criticalMs, round.workMs);
+
+    auto stats = pool.stats();
+    ASSERT_EQ(stats.size(), 2);
+    EXPECT_EQ(stats[0].chunks + stats[1].chunks, 4);
+    EXPECT_GE(stats[0].busyMs + stats[1].busyMs, round.workMs - 1e-9);
+
+    pool.resetStats();
+    for (const ThreadStats &t : pool.stats())
+    {
+        EXPECT_EQ(t.chunks, 0);
+        EXPECT_EQ(t.busyMs, 0);
+    }
+}
+
+// ==================== POOLED PROPAGATION TESTS ====================
+
+TEST_F(ThreadPoolTest, PropagationMatchesAcrossPoolSizes)
+{
+    ThreadPool serial(1);
+    ThreadPool wide(4, true);
+    EXPECT_LE(wide.pinnedCount(), 3);
+
+    auto expected = propagate(&serial);
+    EXPECT_EQ(expected.size(), 224);
+    EXPECT_EQ(propagate(&wide), expected);
+    // the graph's own pool
+    EXPECT_EQ(propagate(nullptr), expected);
+}
+
+TEST_F(ThreadPoolTest, ThreadCountIsConfigurable)
+{
+    auto expected = propagate(nullptr);
+    for (unsigned threads : {1u, 2u, 5u})
+    {
+        AsGraph g;
+        EXPECT_EQ(propagate(g, PropagationEngine::PUSH, threads), expected) << threads << " threads";
+        EXPECT_EQ(g.getThreadCount(), threads);
+    }
+
+    // a pool passed in is replaced by the graph's own
+    ThreadPool external(3);
+    AsGraph g(nullptr, &external);
+    EXPECT_EQ(g.getThreadCount(), 3);
+    g.setThreadCount(0);
+    EXPECT_EQ(g.getThreadCount(), 1);
+}
+
+TEST_F(ThreadPoolTest, PullEngineMatchesPushOnEveryPoolSize)
+{
+    ThreadPool serial(1);
+    auto expected = propagate(&serial);
+    for (unsigned threads : {1u, 2u, 4u})
+    {
+        AsGraph g;
+        EXPECT_EQ(propagate(g, PropagationEngine::PULL, threads), expected) << threads << " threads";
+    }
+}
+
+TEST_F(ThreadPoolTest, PullBatchOnDenseRibsMatchesPush)
+{
+    // the mid-tier ASes pull from 20 stubs each, enough for the batched gather on dense RIBs
+    ThreadPool serial(1);
+    auto expected = propagate(&serial);
+    for (RibLayout layout : {RibLayout::DENSE, RibLayout::SPARSE})
+    {
+        for (unsigned threads : {1u, 4u})
+        {
+            AsGraph g;
+            g.setRibLayout(layout);
+            EXPECT_EQ(propagate(g, PropagationEngine::PULL, threads), expected) << threads << " threads";
+            EXPECT_EQ(g.getRibLayout(), layout);
+        }
+    }
+}
+
+TEST_F(ThreadPoolTest, PrefixShardedMatchesRankByRank)
+{
+    auto expected = propagate(nullptr);
+    for (unsigned threads : {1u, 4u})
+    {
+        for (size_t shards : {0, 1, 3})
+        {
+            AsGraph g;
+            EXPECT_EQ(propagate(g, PropagationEngine::PUSH, threads, shards), expected)
+                << threads << " threads, " << shards << " shards";
+        }
+    }
+}
+
+TEST_F(ThreadPoolTest, DensePeeringMatchesSerial)
+{
+    // an IXP-like mesh: 60 peers with one stub each, exchanged on four threads
+    std::ofstream graphFile("test_pool_mesh.txt");
+    for (int a = 1; a <= 60; ++a)
+    {
+        for (int b = a + 1; b <= 60; ++b)
+        {
+            if ((a * 7 + b) % 3 != 0)
+            {
+                graphFile << a << "|" << b << "|0|bgp\n";
+            }
+        }
+        graphFile << a << "|" << 500 + a << "|-1|bgp\n";
+    }
+    graphFile.close();
+
+    std::ofstream annFile("test_pool_mesh_anns.csv");
+    annFile << "asn,prefix,rov_invalid\n";
+    for (int stub = 501; stub <= 560; stub += 3)
+    {
+        annFile << stub << ",10." << stub - 500 << ".0.0/16,False\n";
+    }
+    annFile.close();
+
+    auto run = [](unsigned threads)
+    {
+        AsGraph g;
+        g.setThreadCount(threads);
+        g.buildGraph("test_pool_mesh.txt");
+        g.flattenGraph();
+        g.processInitialAnnouncements("test_pool_mesh_anns.csv");
+        g.propagateUp();
+        g.propagateAcross();
+        return collectRibs(g);
+    };
+
+    auto serial = run(1);
+    EXPECT_EQ(run(4), serial);
+    // AS1 learns 10.1.0.0/16 from its stub and hands it to its peer AS3
+    EXPECT_EQ(serial.at(1).at("10.1.0.0/16"), RibRoute(std::vector<int>({1, 501}), 501, Relationship::CUSTOMER));
+    EXPECT_EQ(serial.at(3).at("10.1.0.0/16"), RibRoute(std::vector<int>({3, 1, 501}), 1, Relationship::PEER));
+}
+
+TEST_F(ThreadPoolTest, PoolIsSharedBetweenGraphs)
+{
+    ThreadPool pool(3);
+    auto first = propagate(&pool);
+    auto second = propagate(&pool);
+    EXPECT_EQ(first, second);
+}
+
+TEST_F(ThreadPoolTest, CostSplitMatchesUniformSplit)
+{
+    ThreadPool serial(1);
+    auto expected = propagate(&serial);
+    for (PropagationEngine engine : {PropagationEngine::PUSH, PropagationEngine::PULL})
+    {
+        for (RankSplit split : {RankSplit::UNIFORM, RankSplit::COST})
+        {
+            ThreadPool pool(4);
+            AsGraph g(nullptr, &pool);
+            EXPECT_EQ(propagate(g, engine, 0, RANK_BY_RANK, split), expected);
+
+            // every parallel step is recorded, both across steps cover every AS
+            const auto &steps = g.getRankStats();
+            ASSERT_FALSE(steps.empty());
+            size_t across = 0;
+            for (const RankStats &step : steps)
+            {
+                if (step.phase == PropagationPhase::ACROSS)
+                {
+                    ++across;
+                    EXPECT_EQ(step.ases, 224);
+                }
+                EXPECT_EQ(step.cost > 0, split == RankSplit::COST);
+                EXPECT_LE(step.timing.criticalMs, step.timing.workMs + 1e-9);
+            }
+            EXPECT_EQ(across, 2);
+            EXPECT_EQ(g.getThreadStats().size(), 4);
+
+            g.clearRoutes();
+            EXPECT_TRUE(g.getRankStats().empty());
+        }
+    }
+}
+
+TEST_F(ThreadPoolTest, RankStatsCoverOnePropagation)
+{
+    ThreadPool pool(4);
+    AsGraph g(nullptr, &pool);
+    propagate(g);
+    size_t steps = g.getRankStats().size();
+    ASSERT_GT(steps, 0);
+
+    // seeding and propagating again on the same graph replaces the steps instead of adding to them
+    g.processInitialAnnouncements("test_pool_anns.csv");
+    g.propagateUp();
+    g.propagateAcross();
+    g.propagateDown();
+    EXPECT_EQ(g.getRankStats().size(), steps);
+
+    // one thread never splits, so no step is estimated
+    ThreadPool serial(1);
+    AsGraph single(nullptr, &serial);
+    propagate(single);
+    ASSERT_FALSE(single.getRankStats().empty());
+    for (const RankStats &step : single.getRankStats())
+    {
+        EXPECT_EQ(step.cost, 0);
+    }
+}